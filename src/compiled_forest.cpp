@@ -0,0 +1,50 @@
+#include "compiled_forest.h"
+#include "rf_model_gen.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CompiledForest::CompiledForest() {
+    labels.assign(rf_model::labels, rf_model::labels + rf_model::n_classes);
+    base_values.assign(rf_model::base_values, rf_model::base_values + rf_model::n_base_values);
+    binary_case = rf_model::binary_case;
+    positive_weights = rf_model::positive_weights;
+    set_bounds(rf_model::tree_lo, rf_model::tree_hi, rf_model::n_trees, rf_model::same_leaf_mask, rf_model::leaf_mask0);
+}
+
+size_t CompiledForest::num_features() const { return rf_model::n_features; }
+size_t CompiledForest::num_classes() const { return rf_model::n_classes; }
+size_t CompiledForest::num_trees() const { return rf_model::n_trees; }
+size_t CompiledForest::num_nodes() const { return rf_model::n_nodes; }
+
+PredictionResult CompiledForest::predict(const vector<float>& input_data) {
+    PredictionResult result;
+    result.probabilities.resize(num_classes());
+    predict_batch(input_data.data(), 1, &result.label, result.probabilities.data());
+    return result;
+}
+
+void CompiledForest::walk(const float *block, const uint32_t *sel, size_t m, size_t t0, size_t t1, float *score, uint32_t *mask) const {
+    // shards hold consecutive trees, so the sum runs in tree order
+    size_t first = 0;
+    for (size_t s = 0; s < size(rf_model::shards) && first < t1; s++) {
+        size_t last = first + rf_model::shard_trees[s];
+        if (last > t0) {
+            rf_model::shards[s](block, sel, m, (int) (max(t0, first) - first), (int) (min(t1, last) - first), score, mask);
+        }
+        first = last;
+    }
+}
+
+void CompiledForest::predict_batch(const float* rows, size_t n, int64_t* out_labels, float* probs) {
+    run(rows, n, rf_model::n_features, rf_model::n_trees, out_labels, probs, nullptr,
+        [this](auto... a) { walk(a...); });
+}
+
+size_t CompiledForest::predict_confident(const float* rows, size_t n, float zero_thresh, float one_thresh,
+                                         int64_t* out_labels, float* probs) {
+    float thresh[2] = {zero_thresh, one_thresh};
+    return run(rows, n, rf_model::n_features, rf_model::n_trees, out_labels, probs, thresh,
+               [this](auto... a) { walk(a...); });
+}
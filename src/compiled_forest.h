@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "predictor.h"
+#include "forest.h"
+
+// walks trees [t0, t1) of one generated shard (rf_model_gen_*.cpp) for rows sel[0 .. m) of a
+// block, adding their leaf scores to score[sel[r] * NC] and the classes they carry to
+// mask[sel[r]]. The tables are constexpr in the shard, so after inlining every address and size
+// here is a compile-time constant.
+// code[i] is (true child << FB) | (feature + 1) for a branch and (leaf << FB) for a leaf; the
+// false child is the true child + 1, as in Forest
+template <size_t NF, size_t NC, int FB>
+inline void accumulate_trees(const int *roots, int t0, int t1, const float *thr, const uint32_t *code,
+                             const float *leaf, const uint32_t *leaf_mask, uint32_t uniform_mask,
+                             const float *rows, const uint32_t *sel, size_t m, float *score, uint32_t *mask) {
+    const uint32_t low = (1u << FB) - 1;
+    for (int t = t0; t < t1; t++) {
+        // four rows descend side by side, their loads overlap instead of queueing behind each other
+        size_t r = 0;
+        for (; r + 4 <= m; r += 4) {
+            const float *x[4] = {rows + sel[r] * NF, rows + sel[r + 1] * NF, rows + sel[r + 2] * NF, rows + sel[r + 3] * NF};
+            uint32_t i[4] = {(uint32_t) roots[t], (uint32_t) roots[t], (uint32_t) roots[t], (uint32_t) roots[t]};
+            while ((code[i[0]] | code[i[1]] | code[i[2]] | code[i[3]]) & low) {
+                for (int k = 0; k < 4; k++) {
+                    uint32_t c = code[i[k]];
+                    if (c & low) i[k] = (c >> FB) + !(x[k][(c & low) - 1] <= thr[i[k]]);
+                }
+            }
+            for (int k = 0; k < 4; k++) {
+                uint32_t l = code[i[k]] >> FB, s = sel[r + k];
+                for (size_t j = 0; j < NC; j++) score[s * NC + j] += leaf[l * NC + j];
+                mask[s] |= leaf_mask ? leaf_mask[l] : uniform_mask;
+            }
+        }
+        for (; r < m; r++) {
+            const float *x = rows + sel[r] * NF;
+            uint32_t i = roots[t], c;
+            while ((c = code[i]) & low) i = (c >> FB) + !(x[(c & low) - 1] <= thr[i]);
+            uint32_t l = c >> FB;
+            for (size_t j = 0; j < NC; j++) score[sel[r] * NC + j] += leaf[l * NC + j];
+            mask[sel[r]] |= leaf_mask ? leaf_mask[l] : uniform_mask;
+        }
+    }
+}
+
+// rf_model.onnx as compiled into pace by forestgen: nothing is read at startup.
+// Trees are summed in the same order as Forest, so predictions are identical to it
+class CompiledForest : public Predictor, public ForestOutput {
+public:
+    CompiledForest();
+
+    PredictionResult predict(const std::vector<float>& input_data) override;
+    void predict_batch(const float* rows, size_t n, int64_t* labels, float* probs) override;
+    size_t predict_confident(const float* rows, size_t n, float zero_thresh, float one_thresh,
+                             int64_t* labels, float* probs) override;
+
+    size_t num_features() const override;
+    size_t num_classes() const override;
+    size_t num_trees() const override;
+    size_t num_nodes() const;
+
+private:
+    void walk(const float *block, const uint32_t *sel, size_t m, size_t t0, size_t t1, float *score, uint32_t *mask) const;
+};
@@ -0,0 +1,81 @@
+#include "deadline.h"
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+atomic<bool> deadline_flag{false};
+
+namespace {
+
+// started with the first deadline, stopped and joined at exit
+struct Timer {
+    mutex m;
+    condition_variable cv;
+    chrono::steady_clock::time_point at;
+    bool armed = false, quit = false;
+    thread t;
+
+    void run() {
+        unique_lock<mutex> l(m);
+        while (!quit) {
+            if (!armed) {
+                cv.wait(l);
+            } else if (cv.wait_until(l, at) == cv_status::timeout && armed && chrono::steady_clock::now() >= at) {
+                deadline_flag.store(true, memory_order_relaxed);
+                armed = false;
+            }
+        }
+    }
+
+    ~Timer() {
+        {
+            lock_guard<mutex> g(m);
+            quit = true;
+        }
+        cv.notify_all();
+        if (t.joinable()) t.join();
+    }
+};
+
+Timer timer;
+
+}
+
+void set_deadline(double secs) {
+    {
+        lock_guard<mutex> g(timer.m);
+        timer.at = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(secs));
+        timer.armed = true;
+        deadline_flag.store(false, memory_order_relaxed);
+        if (!timer.t.joinable()) timer.t = thread([] { timer.run(); });
+    }
+    timer.cv.notify_all();
+}
+
+double deadline_left() {
+    if (deadline_passed()) return 0;
+    lock_guard<mutex> g(timer.m);
+    if (!timer.armed) return INFINITY;
+    return max(0.0, chrono::duration<double>(timer.at - chrono::steady_clock::now()).count());
+}
+
+// a lock-free store is all a handler may do here
+static void on_signal(int) {
+    deadline_flag.store(true, memory_order_relaxed);
+}
+
+void stop_on_signals() {
+    static_assert(atomic<bool>::is_always_lock_free);
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sa.sa_flags = SA_RESETHAND | SA_RESTART;   // reading the input goes on, the phases check the flag
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+}
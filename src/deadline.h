@@ -0,0 +1,19 @@
+#pragma once
+
+#include <atomic>
+
+// one wall-clock deadline for the search phases. A timer thread raises the flag when it passes,
+// so a solver polls a relaxed load instead of reading a clock and can afford to do it every step
+extern std::atomic<bool> deadline_flag;
+
+// the flag goes up secs seconds from now (steady clock); arming again moves the deadline and
+// lowers the flag
+void set_deadline(double secs);
+
+// seconds until the deadline, 0 once the flag is up, infinity while none is armed
+double deadline_left();
+
+// SIGTERM and SIGINT raise the flag instead of killing the process; a second one kills it
+void stop_on_signals();
+
+inline bool deadline_passed() { return deadline_flag.load(std::memory_order_relaxed); }
@@ -0,0 +1,402 @@
+#include "forest.h"
+
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+// just enough of the protobuf wire format to walk ModelProto -> GraphProto -> NodeProto
+struct Wire {
+    const uint8_t *p, *end;
+
+    bool more() const { return p < end; }
+
+    uint64_t varint() {
+        uint64_t x = 0;
+        for (int sh = 0; sh < 64; sh += 7) {
+            if (p >= end) throw runtime_error("truncated onnx model");
+            uint8_t b = *p++;
+            x |= (uint64_t) (b & 0x7f) << sh;
+            if (!(b & 0x80)) return x;
+        }
+        throw runtime_error("bad varint in onnx model");
+    }
+    void key(int &field, int &wire) {
+        uint64_t k = varint();
+        field = (int) (k >> 3);
+        wire = (int) (k & 7);
+    }
+    Wire sub() {
+        uint64_t n = varint();
+        if (n > (uint64_t) (end - p)) throw runtime_error("truncated onnx model");
+        Wire w{p, p + n};
+        p += n;
+        return w;
+    }
+    string str() { Wire w = sub(); return string((const char*) w.p, w.end - w.p); }
+    float f32() { float f; need(4); memcpy(&f, p, 4); p += 4; return f; }
+    double f64() { double d; need(8); memcpy(&d, p, 8); p += 8; return d; }
+    void need(size_t n) { if ((size_t) (end - p) < n) throw runtime_error("truncated onnx model"); }
+    void skip(int wire) {
+        if (wire == 0) varint();
+        else if (wire == 1) { need(8); p += 8; }
+        else if (wire == 2) sub();
+        else if (wire == 5) { need(4); p += 4; }
+        else throw runtime_error("unsupported protobuf wire type");
+    }
+    // repeated scalars arrive either packed or one per key
+    void floats(int wire, vector<float> &out) {
+        if (wire == 5) { out.push_back(f32()); return; }
+        Wire w = sub();
+        while (w.more()) out.push_back(w.f32());
+    }
+    void ints(int wire, vector<int64_t> &out) {
+        if (wire == 0) { out.push_back((int64_t) varint()); return; }
+        Wire w = sub();
+        while (w.more()) out.push_back((int64_t) w.varint());
+    }
+};
+
+struct Attr {
+    string s;
+    vector<float> floats;
+    vector<int64_t> ints;
+    vector<string> strings;
+};
+
+// TensorProto holding float or double values (the *_as_tensor attributes)
+vector<float> tensor_values(Wire w) {
+    vector<float> out;
+    vector<double> dbl;
+    string raw;
+    int64_t type = 0;
+    while (w.more()) {
+        int f, t;
+        w.key(f, t);
+        if (f == 2) type = (int64_t) w.varint();
+        else if (f == 4) w.floats(t, out);
+        else if (f == 10) {
+            if (t == 1) dbl.push_back(w.f64());
+            else { Wire q = w.sub(); while (q.more()) dbl.push_back(q.f64()); }
+        }
+        else if (f == 9) raw = w.str();
+        else w.skip(t);
+    }
+    if (!raw.empty()) {
+        if (type == 11) {
+            dbl.resize(raw.size() / 8);
+            memcpy(dbl.data(), raw.data(), dbl.size() * 8);
+        } else {
+            out.resize(raw.size() / 4);
+            memcpy(out.data(), raw.data(), out.size() * 4);
+        }
+    }
+    for (double d : dbl) out.push_back((float) d);
+    return out;
+}
+
+void read_attr(Wire w, unordered_map<string, Attr> &attrs) {
+    string name;
+    Attr a;
+    while (w.more()) {
+        int f, t;
+        w.key(f, t);
+        if (f == 1) name = w.str();
+        else if (f == 4) a.s = w.str();
+        else if (f == 5) a.floats = tensor_values(w.sub());
+        else if (f == 7) w.floats(t, a.floats);
+        else if (f == 8) w.ints(t, a.ints);
+        else if (f == 9) a.strings.push_back(w.str());
+        else w.skip(t);
+    }
+    attrs[name] = std::move(a);
+}
+
+// second dimension of the first graph input, 0 when it is symbolic
+size_t input_width(Wire vi) {
+    size_t width = 0;
+    while (vi.more()) {
+        int f, t;
+        vi.key(f, t);
+        if (f != 2) { vi.skip(t); continue; }
+        Wire type = vi.sub();
+        while (type.more()) {
+            type.key(f, t);
+            if (f != 1) { type.skip(t); continue; }
+            Wire tensor = type.sub();
+            while (tensor.more()) {
+                tensor.key(f, t);
+                if (f != 2) { tensor.skip(t); continue; }
+                Wire shape = tensor.sub();
+                int d = 0;
+                while (shape.more()) {
+                    shape.key(f, t);
+                    if (f != 1) { shape.skip(t); continue; }
+                    Wire dim = shape.sub();
+                    while (dim.more()) {
+                        dim.key(f, t);
+                        if (f == 1 && d == 1) width = dim.varint();
+                        else dim.skip(t);
+                    }
+                    d++;
+                }
+            }
+        }
+    }
+    return width;
+}
+
+}
+
+Forest::Forest(const string &model_path) {
+    ifstream in(model_path, ios::binary);
+    if (!in) throw runtime_error("cannot open model " + model_path);
+    stringstream ss;
+    ss << in.rdbuf();
+    string bytes = ss.str();
+
+    Wire model{(const uint8_t*) bytes.data(), (const uint8_t*) bytes.data() + bytes.size()};
+    unordered_map<string, Attr> attrs;
+    bool found = false;
+    while (model.more()) {
+        int f, t;
+        model.key(f, t);
+        if (f != 7) { model.skip(t); continue; }
+        Wire graph = model.sub();
+        while (graph.more()) {
+            graph.key(f, t);
+            if (f == 11 && !n_features) { n_features = input_width(graph.sub()); continue; }
+            if (f != 1) { graph.skip(t); continue; }
+            Wire node = graph.sub();
+            string op;
+            unordered_map<string, Attr> na;
+            while (node.more()) {
+                node.key(f, t);
+                if (f == 4) op = node.str();
+                else if (f == 5) read_attr(node.sub(), na);
+                else node.skip(t);
+            }
+            if (op == "TreeEnsembleClassifier") {
+                attrs = std::move(na);
+                found = true;
+            }
+        }
+    }
+    if (!found) throw runtime_error("no TreeEnsembleClassifier in " + model_path);
+
+    auto &treeids = attrs["nodes_treeids"].ints, &nodeids = attrs["nodes_nodeids"].ints;
+    auto &featureids = attrs["nodes_featureids"].ints;
+    auto &modes = attrs["nodes_modes"].strings;
+    auto &trueids = attrs["nodes_truenodeids"].ints, &falseids = attrs["nodes_falsenodeids"].ints;
+    auto &values = attrs.count("nodes_values_as_tensor") ? attrs["nodes_values_as_tensor"].floats : attrs["nodes_values"].floats;
+    auto &ctree = attrs["class_treeids"].ints, &cnode = attrs["class_nodeids"].ints, &cid = attrs["class_ids"].ints;
+    auto &cw = attrs.count("class_weights_as_tensor") ? attrs["class_weights_as_tensor"].floats : attrs["class_weights"].floats;
+    labels = attrs["classlabels_int64s"].ints;
+    base_values = attrs.count("base_values_as_tensor") ? attrs["base_values_as_tensor"].floats : attrs["base_values"].floats;
+
+    size_t nn = treeids.size();
+    if (labels.empty()) throw runtime_error("only integer class labels are supported");
+    if (nodeids.size() != nn || featureids.size() != nn || modes.size() != nn || trueids.size() != nn
+        || falseids.size() != nn || values.size() != nn)
+        throw runtime_error("inconsistent tree attributes");
+    if (ctree.size() != cw.size() || cnode.size() != cw.size() || cid.size() != cw.size())
+        throw runtime_error("inconsistent class attributes");
+    if (attrs.count("post_transform") && !attrs["post_transform"].s.empty() && attrs["post_transform"].s != "NONE")
+        throw runtime_error("unsupported post_transform " + attrs["post_transform"].s);
+    for (int64_t m : attrs["nodes_missing_value_tracks_true"].ints)
+        if (m) throw runtime_error("missing value tracking is not supported");
+    if (labels.size() == 2 && !base_values.empty()) throw runtime_error("binary base_values are not supported");
+    if (labels.size() > 32) throw runtime_error("too many classes");
+
+    size_t nc = labels.size();
+    auto key = [](int64_t tree, int64_t node) { return (uint64_t) tree << 32 | (uint32_t) node; };
+    unordered_map<uint64_t, int> at;			// (tree, node) -> attribute position
+    vector<int64_t> order;						// tree ids by first appearance, the order ORT sums in
+    unordered_map<int64_t, vector<int>> members;
+    for (size_t i = 0; i < nn; i++) {
+        at[key(treeids[i], nodeids[i])] = (int) i;
+        if (!members.count(treeids[i])) order.push_back(treeids[i]);
+        members[treeids[i]].push_back((int) i);
+    }
+    unordered_map<uint64_t, vector<int>> weights;	// leaf -> class weight entries
+    positive_weights = true;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < cw.size(); i++) {
+        if (cid[i] < 0 || cid[i] >= (int64_t) nc) throw runtime_error("class id out of range");
+        weights[key(ctree[i], cnode[i])].push_back((int) i);
+        seen |= 1u << cid[i];
+        if (cw[i] < 0) positive_weights = false;
+    }
+    binary_case = nc == 2 && __builtin_popcount(seen) == 1;
+
+    for (int64_t tree : order) {
+        // the root is the only node no other node of the tree points at
+        unordered_map<int64_t, bool> child;
+        for (int i : members[tree]) {
+            if (modes[i] == "LEAF") continue;
+            child[trueids[i]] = child[falseids[i]] = true;
+        }
+        int root = -1;
+        for (int i : members[tree]) if (!child.count(nodeids[i])) { root = i; break; }
+        if (root < 0) throw runtime_error("tree without root");
+
+        // breadth-first: frontier[k] is (attribute position, flat slot)
+        vector<pair<int, int>> frontier = {{root, (int) nodes.size()}};
+        roots.push_back((int) nodes.size());
+        nodes.emplace_back();
+        for (size_t k = 0; k < frontier.size(); k++) {
+            auto [a, slot] = frontier[k];
+            const string &mode = modes[a];
+            if (mode == "LEAF") {
+                int li = (int) leaf_mask.size();
+                leaf_score.resize(leaf_score.size() + nc, 0.0f);
+                uint32_t mask = 0;
+                for (int w : weights[key(tree, nodeids[a])]) {
+                    leaf_score[(size_t) li * nc + cid[w]] += cw[w];
+                    mask |= 1u << cid[w];
+                }
+                leaf_mask.push_back(mask);
+                nodes[slot] = {0.0f, -1, li};
+                continue;
+            }
+            auto tc = at.find(key(tree, trueids[a])), fc = at.find(key(tree, falseids[a]));
+            if (tc == at.end() || fc == at.end()) throw runtime_error("dangling child in tree");
+            int yes = tc->second, no = fc->second;
+            float thr = values[a];
+            if (mode == "BRANCH_LEQ") {}
+            else if (mode == "BRANCH_LT") thr = nextafterf(thr, -INFINITY);
+            else if (mode == "BRANCH_GT") swap(yes, no);
+            else if (mode == "BRANCH_GTE") { thr = nextafterf(thr, -INFINITY); swap(yes, no); }
+            else throw runtime_error("unsupported split mode " + mode);
+
+            int c = (int) nodes.size();
+            nodes.emplace_back();
+            nodes.emplace_back();
+            nodes[slot] = {thr, (int) featureids[a], c};
+            frontier.push_back({yes, c});
+            frontier.push_back({no, c + 1});
+        }
+    }
+    size_t width = 0;
+    for (const Node &x : nodes) width = max(width, (size_t) (x.feature + 1));
+    if (!n_features) n_features = width;
+    if (width > n_features) throw runtime_error("split on a feature beyond the model input");
+
+    vector<float> lo(roots.size() * nc, INFINITY), hi(roots.size() * nc, -INFINITY);
+    bool same = true;
+    for (size_t t = 0; t < roots.size(); t++) {
+        size_t end = t + 1 < roots.size() ? roots[t + 1] : nodes.size();
+        for (size_t i = roots[t]; i < end; i++) {
+            if (nodes[i].feature >= 0) continue;
+            int l = nodes[i].next;
+            same = same && leaf_mask[l] == leaf_mask[0];
+            for (size_t k = 0; k < nc; k++) {
+                lo[t * nc + k] = min(lo[t * nc + k], leaf_score[(size_t) l * nc + k]);
+                hi[t * nc + k] = max(hi[t * nc + k], leaf_score[(size_t) l * nc + k]);
+            }
+        }
+    }
+    set_bounds(lo.data(), hi.data(), roots.size(), same, leaf_mask.empty() ? 0 : leaf_mask[0]);
+}
+
+int64_t ForestOutput::finalize(float *score, uint32_t mask, float *probs) const {
+    size_t nc = labels.size();
+    if (nc > 2) {
+        for (size_t k = 0; k < base_values.size() && k < nc; k++) score[k] += base_values[k];
+        if (!base_values.empty()) mask = (1u << nc) - 1;
+        int best = -1;
+        for (size_t k = 0; k < nc; k++) {
+            if ((mask >> k & 1) && (best < 0 || score[k] > score[best])) best = (int) k;
+        }
+        for (size_t k = 0; k < nc; k++) probs[k] = score[k];
+        return labels[best < 0 ? 0 : best];
+    }
+
+    // binary: an unscored second class is dropped and the remaining score decides
+    bool two = mask >> 1 & 1;
+    float pos = two ? score[1] : ((mask & 1) ? score[0] : 0.0f);
+    bool positive = binary_case && positive_weights ? pos > 0.5f : pos > 0.0f;
+    if (two) {
+        probs[0] = score[0];
+        probs[1] = score[1];
+    } else if (binary_case) {
+        probs[0] = positive_weights ? 1.0f - score[0] : -score[0];
+        probs[1] = score[0];
+    } else {
+        probs[0] = score[0];
+        probs[1] = 0.0f;
+    }
+    return positive ? labels[1] : labels[0];
+}
+
+void ForestOutput::set_bounds(const float *tree_lo, const float *tree_hi, size_t trees, bool same_mask, uint32_t mask) {
+    size_t nc = labels.size();
+    rest_lo.assign((trees + 1) * nc, 0.0);
+    rest_hi.assign((trees + 1) * nc, 0.0);
+    double mag = 1;
+    for (size_t t = trees; t-- > 0;) {
+        for (size_t k = 0; k < nc; k++) {
+            rest_lo[t * nc + k] = rest_lo[(t + 1) * nc + k] + tree_lo[t * nc + k];
+            rest_hi[t * nc + k] = rest_hi[(t + 1) * nc + k] + tree_hi[t * nc + k];
+        }
+        mag += max(fabs(tree_lo[t * nc]), fabs(tree_hi[t * nc])) + (nc > 1 ? max(fabs(tree_lo[t * nc + 1]), fabs(tree_hi[t * nc + 1])) : 0.0);
+    }
+    // a float sum of `trees` terms is off by at most trees * FLT_EPSILON / 2 of their magnitude
+    slack = (trees + 2) * FLT_EPSILON * mag;
+
+    // finalize() on a binary model: label 1 iff score[pos] > cut, then probs[1] = score[pos] and
+    // probs[0] = 1 - score[pos] (complement) or score[0]
+    pos = mask >> 1 & 1;
+    cut = binary_case && positive_weights ? 0.5 : 0.0;
+    complement = binary_case && !pos;
+    early_exit = nc == 2 && same_mask && mask && base_values.empty() && (positive_weights || !binary_case);
+}
+
+bool ForestOutput::can_reach(const float *score, size_t t, float zero_thresh, float one_thresh) const {
+    const size_t nc = 2;
+    double lo = score[pos] + rest_lo[t * nc + pos] - slack, hi = score[pos] + rest_hi[t * nc + pos] + slack;
+    if (hi > cut && hi >= one_thresh) return true;
+    if (lo > cut) return false;
+    if (complement) return 1 - lo >= zero_thresh;
+    if (pos == 0) return min(hi, cut) >= zero_thresh;
+    return score[0] + rest_hi[t * nc] + slack >= zero_thresh;
+}
+
+PredictionResult Forest::predict(const vector<float>& input_data) {
+    PredictionResult result;
+    result.probabilities.resize(num_classes());
+    predict_batch(input_data.data(), 1, &result.label, result.probabilities.data());
+    return result;
+}
+
+void Forest::walk(const float *block, const uint32_t *sel, size_t m, size_t t0, size_t t1, float *score, uint32_t *mask) const {
+    // the rows walk each tree before moving on, so a tree stays in cache for the block
+    size_t nc = labels.size();
+    for (size_t t = t0; t < t1; t++) {
+        for (size_t r = 0; r < m; r++) {
+            int l = leaf((int) t, block + sel[r] * n_features);
+            const float *w = &leaf_score[(size_t) l * nc];
+            for (size_t k = 0; k < nc; k++) score[sel[r] * nc + k] += w[k];
+            mask[sel[r]] |= leaf_mask[l];
+        }
+    }
+}
+
+void Forest::predict_batch(const float* rows, size_t n, int64_t* out_labels, float* probs) {
+    run(rows, n, n_features, roots.size(), out_labels, probs, nullptr,
+        [this](auto... a) { walk(a...); });
+}
+
+size_t Forest::predict_confident(const float* rows, size_t n, float zero_thresh, float one_thresh,
+                                 int64_t* out_labels, float* probs) {
+    float thresh[2] = {zero_thresh, one_thresh};
+    return run(rows, n, n_features, roots.size(), out_labels, probs, thresh,
+               [this](auto... a) { walk(a...); });
+}
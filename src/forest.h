@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "predictor.h"
+
+// how summed leaf scores become a label and probabilities, following the rules of ONNX Runtime.
+// Shared by Forest and the model compiled into pace (compiled_forest.h)
+struct ForestOutput {
+    std::vector<int64_t> labels;
+    std::vector<float> base_values;
+    bool binary_case = false, positive_weights = true;
+
+    int64_t finalize(float *score, uint32_t mask, float *probs) const;
+
+    // early exit: rest_lo / rest_hi[t * nc + k] bound what trees t.. can still add to class k,
+    // slack covers the float rounding of that sum. Only binary models whose leaves all carry
+    // the same classes qualify, otherwise the label rule itself could change on the way
+    std::vector<double> rest_lo, rest_hi;
+    double slack = 0, cut = 0;
+    int pos = 0;
+    bool complement = false, early_exit = false;
+
+    // tree_lo / tree_hi[t * nc + k]: smallest and largest class k score of tree t's leaves
+    void set_bounds(const float *tree_lo, const float *tree_hi, size_t trees, bool same_mask, uint32_t mask);
+
+    // whether a row holding `score` after trees 0 .. t-1 can still end at label 0 with probability
+    // >= zero_thresh or label 1 with probability >= one_thresh
+    bool can_reach(const float *score, size_t t, float zero_thresh, float one_thresh) const;
+
+    // the row loop of both forests, over blocks of 64 rows.
+    // walk(block, sel, m, t0, t1, score, mask) adds trees [t0, t1) for rows sel[0 .. m) of the
+    // block into score[sel[r] * nc] and mask[sel[r]]. With thresholds (zero, one) rows that
+    // cannot reach them are dropped between trees and labelled -1; returns the tree evaluations
+    // skipped
+    template <typename Walk>
+    size_t run(const float *rows, size_t n, size_t nf, size_t trees, int64_t *out, float *probs,
+               const float *thresh, Walk walk) const {
+        const size_t B = 64;
+        size_t nc = labels.size(), skipped = 0;
+        bool exit = thresh && early_exit;
+        std::vector<float> score(B * nc);
+        uint32_t mask[B], sel[B];
+        for (size_t lo = 0; lo < n; lo += B) {
+            size_t m = std::min(B, n - lo), active = m;
+            const float *block = rows + lo * nf;
+            std::fill(score.begin(), score.end(), 0.0f);
+            std::fill(mask, mask + B, 0u);
+            for (size_t r = 0; r < m; r++) sel[r] = (uint32_t) r;
+            if (!exit) walk(block, sel, m, 0, trees, score.data(), mask);
+            for (size_t t = 0; exit && t < trees && active; t++) {
+                walk(block, sel, active, t, t + 1, score.data(), mask);
+                size_t keep = 0;
+                for (size_t r = 0; r < active; r++) {
+                    if (can_reach(&score[sel[r] * nc], t + 1, thresh[0], thresh[1])) sel[keep++] = sel[r];
+                    else out[lo + sel[r]] = -1;
+                }
+                skipped += (active - keep) * (trees - t - 1);
+                active = keep;
+            }
+            if (exit) {
+                for (size_t r = 0; r < active; r++) {
+                    size_t i = sel[r];
+                    out[lo + i] = finalize(&score[i * nc], mask[i], probs + (lo + i) * nc);
+                }
+            } else {
+                for (size_t r = 0; r < m; r++) out[lo + r] = finalize(&score[r * nc], mask[r], probs + (lo + r) * nc);
+            }
+        }
+        return skipped;
+    }
+};
+
+// TreeEnsembleClassifier read straight out of an .onnx file and flattened for evaluation,
+// a drop-in replacement for MLPredictor that needs no onnxruntime.
+// Every tree is stored breadth-first with the two children of a branch side by side; all split
+// modes are normalised to `x <= threshold` (true child first). Scores are summed in float in tree
+// order and finalised with the same rules as ONNX Runtime, so labels and probabilities match it.
+class Forest : public Predictor, public ForestOutput {
+public:
+    explicit Forest(const std::string &model_path);
+
+    PredictionResult predict(const std::vector<float>& input_data) override;
+    void predict_batch(const float* rows, size_t n, int64_t* labels, float* probs) override;
+    size_t predict_confident(const float* rows, size_t n, float zero_thresh, float one_thresh,
+                             int64_t* labels, float* probs) override;
+
+    size_t num_features() const override { return n_features; }
+    size_t num_classes() const override { return labels.size(); }
+    size_t num_trees() const override { return roots.size(); }
+    size_t num_nodes() const { return nodes.size(); }
+
+    struct Node {
+        float threshold;
+        int feature;	// < 0 marks a leaf
+        int next;		// branch: true child, false child is next + 1; leaf: index into leaf_score
+    };
+
+    // flat model, exposed for code generation
+    std::vector<Node> nodes;
+    std::vector<int> roots;				// first node of every tree
+    std::vector<float> leaf_score;		// num_classes() per leaf
+    std::vector<uint32_t> leaf_mask;	// classes a leaf carries a weight for
+
+    // leaf reached by one row in tree t
+    int leaf(int t, const float *row) const {
+        int i = roots[t];
+        while (nodes[i].feature >= 0) i = nodes[i].next + (row[nodes[i].feature] <= nodes[i].threshold ? 0 : 1);
+        return nodes[i].next;
+    }
+
+private:
+    size_t n_features = 0;
+
+    void walk(const float *block, const uint32_t *sel, size_t m, size_t t0, size_t t1, float *score, uint32_t *mask) const;
+};
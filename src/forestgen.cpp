@@ -0,0 +1,156 @@
+// turns a TreeEnsembleClassifier .onnx file into C++ compiled into pace:
+//   <outdir>/rf_model_gen.h          model shape, class labels and the shard functions
+//   <outdir>/rf_model_gen_<k>.cpp    constexpr node tables of a run of consecutive trees
+// The trees are split into a fixed number of shards (balanced by node count) so that a large
+// model does not have to fit into a single compiler process.
+//
+// usage: forestgen <model.onnx> <outdir> <shards>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <algorithm>
+#include "forest.h"
+
+using namespace std;
+
+static string flt(float x) {
+    if (isnan(x)) return "__builtin_nanf(\"\")";
+    if (isinf(x)) return x > 0 ? "__builtin_inff()" : "-__builtin_inff()";
+    if (x == 0.0f && !signbit(x)) return "0";
+    char b[48];
+    snprintf(b, sizeof b, "%af", (double) x);	// hex literal, the exact value
+    return b;
+}
+
+template <typename T, typename F>
+static void table(ostream &out, const char *decl, const vector<T> &v, size_t lo, size_t hi, F fmt) {
+    out << decl << "[] = {";
+    if (lo == hi) out << "0";	// keeps an empty shard well-formed
+    for (size_t i = lo; i < hi; i++) {
+        if ((i - lo) % 12 == 0) out << "\n    ";
+        out << fmt(v[i]) << ",";
+    }
+    out << "\n};\n";
+}
+
+static void write_file(const string &path, const string &text) {
+    ofstream out(path, ios::binary);
+    out << text;
+    if (!out) throw runtime_error("cannot write " + path);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        cerr << "usage: forestgen <model.onnx> <outdir> <shards>\n";
+        return 1;
+    }
+    try {
+        Forest f(argv[1]);
+        string dir = argv[2];
+        int S = atoi(argv[3]);
+        if (S < 1) throw runtime_error("need at least one shard");
+
+        size_t NF = f.num_features(), NC = f.num_classes(), T = f.num_trees(), N = f.num_nodes();
+        int FB = 1;
+        while ((size_t) 1 << FB <= NF) FB++;	// feature + 1 must fit below the child index
+        if (N >= (size_t) 1 << (32 - FB)) throw runtime_error("model too large for 32-bit node codes");
+
+        uint32_t uniform = f.leaf_mask.empty() ? 0 : f.leaf_mask[0];
+        bool same = true;
+        for (uint32_t m : f.leaf_mask) same = same && m == uniform;
+
+        // leaves are numbered in node order, so leaf_before[t] is the first leaf of tree t
+        vector<size_t> first(T + 1, N), leaf_before(T + 1, 0);
+        for (size_t t = 0; t < T; t++) first[t] = f.roots[t];
+        for (size_t t = 0; t < T; t++) {
+            size_t leaves = 0;
+            for (size_t i = first[t]; i < first[t + 1]; i++) leaves += f.nodes[i].feature < 0;
+            leaf_before[t + 1] = leaf_before[t] + leaves;
+        }
+
+        // consecutive runs of trees with about N / S nodes each
+        vector<size_t> cut(S + 1, T);
+        cut[0] = 0;
+        for (int s = 1; s < S; s++) {
+            size_t t = cut[s - 1];
+            while (t < T && first[t] < N / S * s) t++;
+            cut[s] = t;
+        }
+
+        for (int s = 0; s < S; s++) {
+            size_t t0 = cut[s], t1 = cut[s + 1];
+            size_t n0 = first[t0], n1 = first[t1], l0 = leaf_before[t0], l1 = leaf_before[t1];
+            vector<uint32_t> code(N);
+            for (size_t i = n0; i < n1; i++) {
+                const Forest::Node &x = f.nodes[i];
+                code[i] = x.feature < 0 ? (uint32_t) (x.next - l0) << FB
+                                        : (uint32_t) (x.next - n0) << FB | (uint32_t) (x.feature + 1);
+            }
+            vector<int> roots(T);
+            for (size_t t = t0; t < t1; t++) roots[t] = (int) (first[t] - n0);
+
+            ostringstream out;
+            out << "// generated by forestgen from " << argv[1] << ", do not edit\n"
+                << "#include \"rf_model_gen.h\"\n#include \"compiled_forest.h\"\n\n"
+                << "// trees [" << t0 << ", " << t1 << ")\nnamespace {\n\n";
+            table(out, "constexpr int roots", roots, t0, t1, [](int v) { return to_string(v); });
+            table(out, "constexpr float thr", f.nodes, n0, n1, [](const Forest::Node &x) { return flt(x.threshold); });
+            table(out, "constexpr uint32_t code", code, n0, n1, [](uint32_t v) { return to_string(v); });
+            table(out, "constexpr float leaf", f.leaf_score, l0 * NC, l1 * NC, flt);
+            if (!same) table(out, "constexpr uint32_t leaf_mask", f.leaf_mask, l0, l1, [](uint32_t v) { return to_string(v); });
+            out << "\n}\n\nvoid rf_model::shard_" << s << "(const float *rows, const uint32_t *sel, size_t m, int t0, int t1, float *score, uint32_t *mask) {\n"
+                << "    accumulate_trees<n_features, n_classes, feature_bits>(roots, t0, t1, thr, code, leaf, "
+                << (same ? "nullptr" : "leaf_mask") << ", " << uniform << "u, rows, sel, m, score, mask);\n}\n";
+            write_file(dir + "/rf_model_gen_" + to_string(s) + ".cpp", out.str());
+        }
+
+        ostringstream h;
+        h << "// generated by forestgen from " << argv[1] << ", do not edit\n#pragma once\n\n"
+          << "#include <cstddef>\n#include <cstdint>\n\nnamespace rf_model {\n\n"
+          << "constexpr size_t n_features = " << NF << ", n_classes = " << NC << ", n_trees = " << T
+          << ", n_nodes = " << N << ";\n"
+          << "constexpr int feature_bits = " << FB << ";\n"
+          << "constexpr bool binary_case = " << (f.binary_case ? "true" : "false")
+          << ", positive_weights = " << (f.positive_weights ? "true" : "false") << ";\n";
+        table(h, "constexpr int64_t labels", f.labels, 0, NC, [](int64_t v) { return to_string(v) + "LL"; });
+        h << "constexpr size_t n_base_values = " << f.base_values.size() << ";\n";
+        table(h, "constexpr float base_values", f.base_values, 0, f.base_values.size(), flt);
+
+        // per tree leaf score range, for early exit
+        vector<float> lo(T * NC, INFINITY), hi(T * NC, -INFINITY);
+        for (size_t t = 0; t < T; t++) {
+            for (size_t i = first[t]; i < first[t + 1]; i++) {
+                if (f.nodes[i].feature >= 0) continue;
+                for (size_t k = 0; k < NC; k++) {
+                    lo[t * NC + k] = min(lo[t * NC + k], f.leaf_score[(size_t) f.nodes[i].next * NC + k]);
+                    hi[t * NC + k] = max(hi[t * NC + k], f.leaf_score[(size_t) f.nodes[i].next * NC + k]);
+                }
+            }
+        }
+        table(h, "constexpr float tree_lo", lo, 0, lo.size(), flt);
+        table(h, "constexpr float tree_hi", hi, 0, hi.size(), flt);
+        h << "constexpr bool same_leaf_mask = " << (same ? "true" : "false") << ";\n"
+          << "constexpr uint32_t leaf_mask0 = " << uniform << "u;\n";
+        vector<size_t> count(S);
+        for (int s = 0; s < S; s++) count[s] = cut[s + 1] - cut[s];
+        table(h, "constexpr size_t shard_trees", count, 0, S, [](size_t v) { return to_string(v); });
+        h << "\n";
+        for (int s = 0; s < S; s++) h << "void shard_" << s << "(const float *rows, const uint32_t *sel, size_t m, int t0, int t1, float *score, uint32_t *mask);\n";
+        h << "\nconstexpr void (*shards[])(const float*, const uint32_t*, size_t, int, int, float*, uint32_t*) = {";
+        for (int s = 0; s < S; s++) h << (s ? ", " : "") << "shard_" << s;
+        h << "};\n\n}\n";
+        write_file(dir + "/rf_model_gen.h", h.str());
+
+        cerr << "forestgen: " << T << " trees, " << N << " nodes in " << S << " shards\n";
+    } catch (const exception &e) {
+        cerr << "forestgen: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,9 @@
 #include "graph.h"
+#include "kcore.h"
+#include "parallel.h"
+#ifdef PACE_NETWORKIT
 #include "netkit.h"
+#endif
 
 #include <vector>
 #include <iostream>
@@ -9,122 +13,161 @@
 #include <stack>
 #include <iomanip>
 #include <cmath>
+#include <climits>
+#include <array>
 #include <algorithm>
+#include <chrono>
 
 using namespace std;
 
-vector<vector<int>> neighbors;
-
 vector<int> deg;
-vector<double> avg_deg, lcc, min_deg, max_deg, sum_nei_degree, deg_elem, deg_set;
+vector<float, aligned_allocator<float>> features;
 
 vector<array<int, 2>> dnode_min2, dnode_max2;
 vector<int> dnode_sum;
 
 double norma = 0.0;
 
-inline double smooth(double r) {
+double smooth(double r) {
 	if (abs(r) < 1e-12 || (isnan(abs(r)))) r = 0.0;
 	return r;
 }
 
-void build_graph(vector<vector<int>> &sets, int &nElems) {
-	int nSets = sets.size();
+void build_graph(const Hypergraph &hg, const vector<int> &rows) {
+	int nElems = hg.elems(), nSets = hg.sets();
 	int totalNodes = nElems + nSets;
+	long nRows = rows.size();
 
-	neighbors.clear(); neighbors.resize(totalNodes + 2);  
 	deg.clear(); deg.resize(totalNodes + 2);
-	avg_deg.resize(nElems + 2);
-	min_deg.resize(nElems + 2);
-	max_deg.resize(nElems + 2);
-	sum_nei_degree.resize(nElems + 2);
-	lcc.resize(nElems + 2);
-	deg_elem.resize(nElems + 2);
-	deg_set.resize(nElems + 2);
+	features.assign((size_t) nRows * NUM_FEATURES, 0.0f);
 	dnode_min2.assign(nSets + 1, {INT_MAX, INT_MAX});
 	dnode_max2.assign(nSets + 1, {INT_MIN, INT_MIN});
 	dnode_sum.assign(nSets + 1, 0);
 
-	G = NetworKit::Graph(totalNodes, false, false);  
+	auto t1 = chrono::steady_clock::now();
+	for (int v = 1; v <= nElems; ++v) deg[v] = hg.degree(v);
+	for (int id = 1; id <= nSets; ++id) deg[nElems + id] = hg.edge_size(id - 1);
 
-	for (int id = 1; id <= nSets; ++id) {
-		int dnode = nElems + id;
-		for (int v : sets[id - 1]) {
-			neighbors[v].push_back(dnode);
-			neighbors[dnode].push_back(v);
-			deg[v]++;
-			deg[dnode]++;
-			G.addEdge(v - 1, dnode - 1); 
-
-			int d = deg[v];
-			dnode_sum[id] += d;
-
-			if (d < dnode_min2[id][0]) {
-				dnode_min2[id][1] = dnode_min2[id][0];
-				dnode_min2[id][0] = d;
-			} else if (d < dnode_min2[id][1]) {
-				dnode_min2[id][1] = d;
-			}
+	// only the hyperedges around the requested elements are summarised
+	vector<char> need(nSets + 1, 0);
+	for (int v : rows) {
+		for (int s : hg.incident(v)) need[s + 1] = 1;
+	}
 
-			if (d > dnode_max2[id][0]) {
-				dnode_max2[id][1] = dnode_max2[id][0];
-				dnode_max2[id][0] = d;
-			} else if (d > dnode_max2[id][1]) {
-				dnode_max2[id][1] = d;
+	// the degree an element had when hyperedge s was read is one more than the rank of s in its
+	// incidence list, so every hyperedge can be summarised on its own
+	parallel_for(1, nSets + 1, [&](long lo, long hi) {
+		for (int id = lo; id < hi; ++id) {
+			if (!need[id]) continue;
+			auto e = hg.edge(id - 1);
+			for (size_t k = 0; k < e.size(); ++k) {
+				int v = e[k];
+				auto inc = hg.incident(v);
+				size_t r = lower_bound(inc.begin(), inc.end(), id - 1) - inc.begin();
+				int d = (int) r + 1;
+				// an element listed twice in the line was counted once per copy
+				if (r + 1 < inc.size() && inc[r + 1] == id - 1) {
+					for (size_t j = 0; j < k; ++j) d += e[j] == v;
+				}
+				dnode_sum[id] += d;
+
+				if (d < dnode_min2[id][0]) {
+					dnode_min2[id][1] = dnode_min2[id][0];
+					dnode_min2[id][0] = d;
+				} else if (d < dnode_min2[id][1]) {
+					dnode_min2[id][1] = d;
+				}
+
+				if (d > dnode_max2[id][0]) {
+					dnode_max2[id][1] = dnode_max2[id][0];
+					dnode_max2[id][0] = d;
+				} else if (d > dnode_max2[id][1]) {
+					dnode_max2[id][1] = d;
+				}
 			}
 		}
-	}
-
-	norma = 0.0;
-	for (int i = 1; i <= nElems; ++i) norma += deg[i];
-	norma /= nElems;
-
-	for (int x = 1; x <= nElems; ++x) {
-		int triangles = 0;
-		int m = 0;
-		for (int d : neighbors[x]) {
-			int sz = neighbors[d].size();
-			int contrib = sz - 1;
-			if (contrib >= 1) {
-				m += contrib;
-				triangles += (contrib * (contrib - 1)) / 2;
+	});
+
+	long long degsum = 0;
+	for (int i = 1; i <= nElems; ++i) degsum += deg[i];
+	norma = (double) degsum / nElems;
+
+	parallel_for(0, nRows, [&](long lo, long hi) {
+		for (long k = lo; k < hi; ++k) {
+			int x = rows[k];
+			int triangles = 0;
+			int m = 0;
+			for (int s : hg.incident(x)) {
+				int sz = hg.edge_size(s);
+				int contrib = sz - 1;
+				if (contrib >= 1) {
+					m += contrib;
+					triangles += (contrib * (contrib - 1)) / 2;
+				}
 			}
+			features[(size_t) k * NUM_FEATURES + LCC] = smooth(m < 2 ? 0.0 : ((double)triangles) / (m * (m - 1) / 2));
 		}
-		lcc[x] = (m < 2 ? 0.0 : ((double)triangles) / (m * (m - 1) / 2));
-		lcc[x] = smooth(lcc[x]);
-	}
-
-	for (int i = 1; i <= nElems; ++i) {
-		int mn = INT_MAX, mx = -1, sum_d = 0, cnt = 0;
-
-		for (int d : neighbors[i]) {
-			int id = d - nElems;
-			int sz = neighbors[d].size();
-			if (sz <= 1) continue;
 
-			int dsum = dnode_sum[id];
-			int local_min = (deg[i] == dnode_min2[id][0]) ? dnode_min2[id][1] : dnode_min2[id][0];
-			int local_max = (deg[i] == dnode_max2[id][0]) ? dnode_max2[id][1] : dnode_max2[id][0];
-			int others = sz - 1;
+		for (long k = lo; k < hi; ++k) {
+			int i = rows[k];
+			int mn = INT_MAX, mx = -1, sum_d = 0, cnt = 0;
 
-			cnt += others;
-			sum_d += (dsum - deg[i]);
-			mn = min(mn, local_min);
-			mx = max(mx, local_max);
-		}
-
-		min_deg[i] = (mn == INT_MAX ? -1 : (double)mn / norma);
-		max_deg[i] = (mx == -1 ? -1 : (double)mx / norma);
-		avg_deg[i] = (cnt == 0 ? -1 : ((double)sum_d / cnt / norma));
-		sum_nei_degree[i] = (cnt == 0 ? -1 : ((double)sum_d / (cnt * norma)));
-	}
+			for (int s : hg.incident(i)) {
+				int id = s + 1;
+				int sz = hg.edge_size(s);
+				if (sz <= 1) continue;
 
+				int dsum = dnode_sum[id];
+				int local_min = (deg[i] == dnode_min2[id][0]) ? dnode_min2[id][1] : dnode_min2[id][0];
+				int local_max = (deg[i] == dnode_max2[id][0]) ? dnode_max2[id][1] : dnode_max2[id][0];
+				int others = sz - 1;
 
-	for (int i = 1; i <= nElems; ++i) {
-		deg_elem[i] = ((double)deg[i]) / nElems;
-		deg_set[i] = ((double)deg[i]) / nSets;
-	}
+				cnt += others;
+				sum_d += (dsum - deg[i]);
+				mn = min(mn, local_min);
+				mx = max(mx, local_max);
+			}
 
+			float *f = &features[(size_t) k * NUM_FEATURES];
+			f[MIN_DEG] = (mn == INT_MAX ? -1 : (double)mn / norma);
+			f[MAX_DEG] = (mx == -1 ? -1 : (double)mx / norma);
+			f[AVG_DEG] = (cnt == 0 ? -1 : ((double)sum_d / cnt / norma));
+			f[SUM_NEI_DEGREE] = (cnt == 0 ? -1 : ((double)sum_d / (cnt * norma)));
+			f[DEG_ELEM] = ((double)deg[i]) / nElems;
+			f[DEG_SET] = ((double)deg[i]) / nSets;
+		}
+	});
+
+	auto t2 = chrono::steady_clock::now();
+	vector<int> coreNumbers = core_numbers(hg); 
+	for (long k = 0; k < nRows; ++k) features[(size_t) k * NUM_FEATURES + CORE] = coreNumbers[rows[k] - 1];
+	auto t3 = chrono::steady_clock::now();
+	auto secs = [](auto a, auto b) { return chrono::duration<double>(b - a).count(); };
+	cerr << "feature calculation done (" << nRows << " of " << nElems << " elements, features " << secs(t1, t2) << " s on " << thread_count()
+		 << " threads, core numbers " << secs(t2, t3) << " s)\n";
+
+#ifdef PACE_NETWORKIT
+	// reference implementation, kept to cross-check core_numbers(). The adjacency is filled in
+	// place from the CSRs: every node reserves its degree once and its list is written by one thread
+	auto t4 = chrono::steady_clock::now();
+	G = NetworKit::Graph(totalNodes, false, false);  
+	parallel_for(0, totalNodes, [&](long lo, long hi) {
+		for (int u = lo; u < hi; ++u) {
+			if (u < nElems) {
+				G.preallocateUndirected(u, hg.degree(u + 1));
+				for (int s : hg.incident(u + 1)) G.addPartialEdge(NetworKit::unsafe, u, nElems + s);
+			} else {
+				G.preallocateUndirected(u, hg.edge_size(u - nElems));
+				for (int v : hg.edge(u - nElems)) G.addPartialEdge(NetworKit::unsafe, u, v - 1);
+			}
+		}
+	});
+	G.setEdgeCount(NetworKit::unsafe, hg.incidences());
+	auto t5 = chrono::steady_clock::now();
 	run(); 
-	cerr << "feature calculation done\n";
+	cerr << "NetworKit graph " << secs(t4, t5) << " s, core decomposition " << secs(t5, chrono::steady_clock::now()) << " s\n";
+	size_t diff = 0;
+	for (int u = 0; u < totalNodes; ++u) diff += (NetworKit::count) coreNumbers[u] != nkCoreNumbers[u];
+	cerr << "NetworKit core numbers: " << diff << " mismatches\n";
+#endif
 }
@@ -1,12 +1,31 @@
 #include <vector>
 #include <unordered_set>
+#include <new>
+#include "hypergraph.h"
 
 using namespace std; 
 
 extern vector<unordered_set<int>> node;		
 
 extern vector<int> deg; 	
-extern vector<double> avg_deg, lcc, min_deg, max_deg, sum_nei_degree, deg_elem, deg_set;
 
-void build_graph(vector<vector<int>> &sets, int &nElems);
+// columns of the feature matrix, in the order the model was trained on
+enum Feature { DEG_ELEM, DEG_SET, MIN_DEG, MAX_DEG, SUM_NEI_DEGREE, AVG_DEG, LCC, CORE, NUM_FEATURES };
+
+template <typename T, size_t A = 64>
+struct aligned_allocator {
+	using value_type = T; 
+	template <typename U> struct rebind { using other = aligned_allocator<U, A>; }; 
+	aligned_allocator() = default; 
+	template <typename U> aligned_allocator(const aligned_allocator<U, A> &) {}
+	T *allocate(size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), align_val_t(A))); }
+	void deallocate(T *p, size_t) { ::operator delete(p, align_val_t(A)); }
+	bool operator==(const aligned_allocator &) const { return true; }
+}; 
+
+// row k holds the NUM_FEATURES features of the k-th element passed to build_graph, row-major,
+// so the predictor reads it as is
+extern vector<float, aligned_allocator<float>> features; 
+
+void build_graph(const Hypergraph &hg, const vector<int> &rows); 	// features of the elements in rows, measured on all of hg
 double smooth(double r); 
\ No newline at end of file
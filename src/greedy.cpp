@@ -0,0 +1,76 @@
+#include "greedy.h"
+
+using namespace std;
+
+// max-degree greedy over the edges not hit yet. Degrees are kept exact, but the bucket queue
+// is updated lazily: an element stays in the bucket it was put in until it comes up, and then
+// moves down to the bucket of its degree if that has dropped. An element of a newly hit edge
+// costs one read and write of its own entry, where keeping the buckets sorted as in
+// core_numbers would also move two entries of the bucket array, far from it and each other
+vector<int> greedy_hitting_set(const Hypergraph &hg) {
+    int n = hg.elems(), m = hg.sets();
+    struct Node { int deg = 0, seen = -1; };
+    vector<Node> node(n + 1);
+    vector<int> hits(m, 0);
+    vector<vector<int>> bucket;
+    for (int v = n; v >= 1; v--) {
+        int last = -1;
+        for (int s : hg.incident(v)) {
+            node[v].deg += s != last;
+            last = s;
+        }
+        if (node[v].deg >= (int) bucket.size()) bucket.resize(node[v].deg + 1);
+        bucket[node[v].deg].push_back(v);
+    }
+
+    vector<int> chosen;
+    for (int d = (int) bucket.size() - 1; d > 0; d--) {
+        while (!bucket[d].empty()) {
+            int v = bucket[d].back();
+            bucket[d].pop_back();
+            if (node[v].deg < d) {
+                if (node[v].deg) bucket[node[v].deg].push_back(v);
+                continue;
+            }
+            chosen.push_back(v);
+            node[v].deg = 0;
+            for (int s : hg.incident(v)) __builtin_prefetch(&hits[s]);
+            int last = -1;
+            for (int s : hg.incident(v)) {
+                if (s == last) continue;
+                last = s;
+                if (hits[s]++) continue;
+                // s is hit now: each other element of it has one edge less to hit. Their entries
+                // are fetched all at once before the first is needed
+                for (int w : hg.edge(s)) __builtin_prefetch(&node[w]);
+                for (int w : hg.edge(s)) {
+                    Node &a = node[w];
+                    if (a.seen == s || !a.deg) continue;
+                    a.seen = s;
+                    a.deg--;
+                }
+            }
+        }
+    }
+
+    // an element whose edges are all hit by others too is not needed
+    vector<int> res;
+    for (int i = (int) chosen.size() - 1; i >= 0; i--) {
+        int v = chosen[i], last = -1;
+        bool needed = false;
+        for (int s : hg.incident(v)) {
+            needed = needed || (s != last && hits[s] == 1);
+            last = s;
+        }
+        if (needed) {
+            res.push_back(v);
+            continue;
+        }
+        last = -1;
+        for (int s : hg.incident(v)) {
+            if (s != last) hits[s]--;
+            last = s;
+        }
+    }
+    return res;
+}
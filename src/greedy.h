@@ -0,0 +1,9 @@
+#pragma once
+
+#include <vector>
+#include "hypergraph.h"
+
+// a hitting set in time linear in the incidences, for a solution before anything expensive runs:
+// takes the element that hits the most edges not hit yet, then drops chosen elements whose edges
+// all stay hit, the last taken first. Empty hyperedges are ignored
+std::vector<int> greedy_hitting_set(const Hypergraph &hg);
@@ -0,0 +1,99 @@
+#include "hgb.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+static const char MAGIC[8] = {'H', 'G', 'R', 'B', 'I', 'N', 0, 0};
+static const uint32_t VERSION = 1;
+
+static size_t pad8(size_t x) { return (x + 7) & ~(size_t) 7; }
+
+// word-at-a-time mix over 8-byte padded blocks, so it can be fed piece by piece while writing
+static uint64_t mix(uint64_t h, const char *p, size_t len) {
+	for (size_t i = 0; i < len; i += 8) {
+		uint64_t w = 0;
+		memcpy(&w, p + i, len - i >= 8 ? 8 : len - i);
+		h = (h ^ w) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
+
+static const uint64_t SEED = 0x9e3779b97f4a7c15ULL;
+
+// rows must start at 0 and never go back, end at nnz, and hold ids in [lo, hi): anything else
+// would be read past the mapped file
+static void check_rows(const CSRView &v, size_t nnz, int lo, int hi) {
+	if (v.off[0] != 0 || v.off[v.n] != nnz) throw runtime_error("corrupt .hgb offsets");
+	for (int r = 0; r < v.n; r++) {
+		if (v.off[r + 1] < v.off[r]) throw runtime_error("corrupt .hgb offsets");
+	}
+	for (size_t i = 0; i < nnz; i++) {
+		if (v.ids[i] < lo || v.ids[i] >= hi) throw runtime_error("corrupt .hgb ids");
+	}
+}
+
+bool is_hgb(const char *buf, size_t len) {
+	return len >= sizeof(HgbHeader) && memcmp(buf, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+Hypergraph load_hgb(const char *buf, size_t len, shared_ptr<const void> keep) {
+	if (!is_hgb(buf, len)) throw runtime_error("not an .hgb file");
+	HgbHeader h;
+	memcpy(&h, buf, sizeof(h));
+	if (h.version != VERSION) throw runtime_error("unsupported .hgb version");
+	if (h.nElems < 0 || h.nSets < 0) throw runtime_error("corrupt .hgb header");
+
+	if (h.incidences > len) throw runtime_error("truncated .hgb file");	// nor do the sizes below overflow
+
+	size_t eoff = sizeof(HgbHeader);
+	size_t moff = eoff + ((size_t) h.nSets + 1) * sizeof(size_t);
+	size_t eids = moff + ((size_t) h.nElems + 2) * sizeof(size_t);
+	size_t mids = eids + pad8(h.incidences * sizeof(int));
+	size_t total = mids + pad8(h.incidences * sizeof(int));
+	if (len < total) throw runtime_error("truncated .hgb file");
+	if ((h.flags & HGB_CHECKSUM) && mix(SEED, buf + eoff, total - eoff) != h.checksum)
+		throw runtime_error(".hgb checksum mismatch");
+
+	CSRView ev{(const size_t*) (buf + eoff), (const int*) (buf + eids), h.nSets};
+	CSRView mv{(const size_t*) (buf + moff), (const int*) (buf + mids), h.nElems + 1};
+	check_rows(ev, h.incidences, 1, h.nElems + 1);
+	check_rows(mv, h.incidences, 0, h.nSets);
+	return Hypergraph(h.nElems, ev, mv, std::move(keep));
+}
+
+void save_hgb(const Hypergraph &hg, const char *path, bool sum) {
+	const CSRView &e = hg.edge_csr(), &m = hg.member_csr();
+	HgbHeader h = {};
+	memcpy(h.magic, MAGIC, sizeof(MAGIC));
+	h.version = VERSION;
+	h.flags = sum ? HGB_CHECKSUM : 0;
+	h.nElems = hg.elems();
+	h.nSets = hg.sets();
+	h.incidences = hg.incidences();
+
+	ofstream out(path, ios::binary);
+	if (!out) throw runtime_error(string("cannot write ") + path);
+	out.write((const char*) &h, sizeof(h));
+
+	uint64_t acc = SEED;
+	auto put = [&](const void *p, size_t bytes) {
+		static const char zero[8] = {};
+		out.write((const char*) p, bytes);
+		out.write(zero, pad8(bytes) - bytes);
+		if (sum) acc = mix(acc, (const char*) p, bytes);
+	};
+	put(e.off, ((size_t) e.rows() + 1) * sizeof(size_t));
+	put(m.off, ((size_t) m.rows() + 1) * sizeof(size_t));
+	put(e.ids, h.incidences * sizeof(int));
+	put(m.ids, h.incidences * sizeof(int));
+
+	// header goes last, once the checksum is known
+	h.checksum = sum ? acc : 0;
+	out.seekp(0);
+	out.write((const char*) &h, sizeof(h));
+	if (!out) throw runtime_error(string("write failed: ") + path);
+}
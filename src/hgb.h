@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "hypergraph.h"
+
+// binary hypergraph cache (.hgb): a fixed header followed by both CSR directions, laid out so a
+// mapped file can be used in place. Native byte order, every array starts 8-byte aligned:
+//   header | edge offsets (nSets + 1) | member offsets (nElems + 2) | edge ids | member ids
+struct HgbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    int32_t nElems;
+    int32_t nSets;
+    uint64_t incidences;
+    uint64_t checksum;
+};
+
+const uint32_t HGB_CHECKSUM = 1;
+
+bool is_hgb(const char *buf, size_t len);
+
+// the hypergraph borrows its arrays from `buf`, which stays alive as long as the hypergraph does;
+// throws if the header, sizes or checksum do not match, or an offset or id points outside the file
+Hypergraph load_hgb(const char *buf, size_t len, std::shared_ptr<const void> keep);
+
+void save_hgb(const Hypergraph &hg, const char *path, bool checksum = true);
@@ -0,0 +1,37 @@
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+
+#include "parser.h"
+#include "hgb.h"
+
+using namespace std;
+
+// converts a text .hgr instance into the binary .hgb cache read by pace
+int main(int argc, char **argv) {
+	bool sum = true;
+	const char *in = nullptr, *out = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--no-checksum")) sum = false;
+		else if (!in) in = argv[i];
+		else out = argv[i];
+	}
+	if (!in || !out) {
+		cerr << "usage: hgrconv [--no-checksum] <input.hgr | -> <output.hgb>\n";
+		return 1;
+	}
+
+	try {
+		InputBuffer inp(strcmp(in, "-") ? in : nullptr);
+		int nElems, nSets;
+		CSR sets;
+		parse_hgr(inp.data(), inp.size(), nElems, nSets, sets);
+		Hypergraph hg(nElems, std::move(sets));
+		save_hgb(hg, out, sum);
+		cerr << hg.elems() << " elements, " << hg.sets() << " hyperedges, " << hg.incidences() << " incidences\n";
+	} catch (const exception &e) {
+		cerr << e.what() << "\n";
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,47 @@
+#include "hypergraph.h"
+
+#include <utility>
+
+CSR transpose(const CSR &a, int cols) {
+    CSR t;
+    t.off.assign(cols + 1, 0);
+    for (int x : a.ids) t.off[x + 1]++;
+    for (int c = 0; c < cols; c++) t.off[c + 1] += t.off[c];
+
+    t.ids.resize(a.ids.size());
+    std::vector<size_t> pos(t.off.begin(), t.off.end() - 1);
+    for (int r = 0; r < a.rows(); r++) {
+        for (int x : a.row(r)) t.ids[pos[x]++] = r;
+    }
+    return t;
+}
+
+Hypergraph::Hypergraph(int nElems, CSR edges) : n(nElems), e(std::move(edges)) {
+    m = transpose(e, n + 1);
+    ev = e.view();
+    mv = m.view();
+}
+
+Hypergraph::Hypergraph(int nElems, CSRView edges, CSRView member, std::shared_ptr<const void> keep)
+    : n(nElems), ev(edges), mv(member), keep(std::move(keep)) {}
+
+Hypergraph Hypergraph::project(const std::vector<bool> &delElem, const std::vector<bool> &delSet, std::vector<int> &rmap) const {
+    std::vector<int> mapp(n + 1, 0);
+    rmap.assign(1, 0);
+    for (int v = 1; v <= n; v++) {
+        if (delElem[v]) continue;
+        mapp[v] = (int) rmap.size();
+        rmap.push_back(v);
+    }
+
+    CSR sub;
+    sub.off.reserve(sets() + 1);
+    for (int s = 0; s < sets(); s++) {
+        if (delSet[s]) continue;
+        for (int v : edge(s)) {
+            if (!delElem[v]) sub.ids.push_back(mapp[v]);
+        }
+        sub.end_row();
+    }
+    return Hypergraph((int) rmap.size() - 1, std::move(sub));
+}
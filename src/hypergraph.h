@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <memory>
+#include <cstddef>
+
+// read-only compressed sparse rows over memory owned elsewhere (a CSR or a mapped file)
+struct CSRView {
+    const size_t *off = nullptr;
+    const int *ids = nullptr;
+    int n = 0;
+
+    int rows() const { return n; }
+    size_t nnz() const { return n ? off[n] : 0; }
+    int size(int r) const { return (int) (off[r + 1] - off[r]); }
+    std::span<const int> row(int r) const { return {ids + off[r], ids + off[r + 1]}; }
+};
+
+// compressed sparse rows: row r owns ids[off[r] .. off[r + 1])
+struct CSR {
+    std::vector<size_t> off = {0};
+    std::vector<int> ids;
+
+    int rows() const { return (int) off.size() - 1; }
+    int size(int r) const { return (int) (off[r + 1] - off[r]); }
+    std::span<const int> row(int r) const { return {ids.data() + off[r], ids.data() + off[r + 1]}; }
+
+    void clear() { off.assign(1, 0); ids.clear(); }
+    void end_row() { off.push_back(ids.size()); }
+    CSRView view() const { return {off.data(), ids.data(), rows()}; }
+};
+
+// column r of the result lists the rows of a containing id r, in increasing order
+CSR transpose(const CSR &a, int cols);
+
+// immutable hypergraph shared by every phase: elements 1..elems(), hyperedges 0..sets() - 1,
+// stored in both directions so no phase has to build its own adjacency. Move-only: the views
+// point either into the owned CSRs or into a buffer kept alive by `keep`
+class Hypergraph {
+public:
+    Hypergraph() = default;
+    Hypergraph(int nElems, CSR edges);
+    Hypergraph(int nElems, CSRView edges, CSRView member, std::shared_ptr<const void> keep);
+    Hypergraph(Hypergraph&&) = default;
+    Hypergraph& operator=(Hypergraph&&) = default;
+    Hypergraph(const Hypergraph&) = delete;
+    Hypergraph& operator=(const Hypergraph&) = delete;
+
+    int elems() const { return n; }
+    int sets() const { return ev.rows(); }
+    size_t incidences() const { return ev.nnz(); }
+
+    std::span<const int> edge(int s) const { return ev.row(s); }			// elements of hyperedge s
+    std::span<const int> incident(int v) const { return mv.row(v); }		// hyperedges containing v, ascending
+    int edge_size(int s) const { return ev.size(s); }
+    int degree(int v) const { return mv.size(v); }
+
+    const CSRView& edge_csr() const { return ev; }
+    const CSRView& member_csr() const { return mv; }
+
+    // keeps the elements and hyperedges not flagged, renumbering both densely in order;
+    // rmap[new element] = old element (rmap[0] unused)
+    Hypergraph project(const std::vector<bool> &delElem, const std::vector<bool> &delSet, std::vector<int> &rmap) const;
+
+private:
+    int n = 0;
+    CSR e, m;
+    CSRView ev, mv;
+    std::shared_ptr<const void> keep;
+};
@@ -0,0 +1,54 @@
+#include "kcore.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Batagelj-Zaversnik peeling: nodes sit in one array sorted by remaining degree, bucket d
+// starting at begin[d]. Taking the nodes in array order removes a minimum-degree node each time;
+// a neighbour that loses an edge is swapped to the front of its bucket and the bucket border
+// moves past it, which puts it at the end of the bucket below. O(nodes + incidences)
+vector<int> core_numbers(const Hypergraph &hg) {
+    int nElems = hg.elems(), nSets = hg.sets();
+    int n = nElems + nSets;
+    vector<int> deg(n), core(n), order(n), at(n);
+    int maxDeg = 0;
+    for (int v = 1; v <= nElems; v++) deg[v - 1] = hg.degree(v);
+    for (int s = 0; s < nSets; s++) deg[nElems + s] = hg.edge_size(s);
+    for (int u = 0; u < n; u++) maxDeg = max(maxDeg, deg[u]);
+
+    vector<int> begin(maxDeg + 2, 0);
+    for (int u = 0; u < n; u++) begin[deg[u] + 1]++;
+    for (int d = 0; d <= maxDeg; d++) begin[d + 1] += begin[d];
+    {
+        vector<int> fill(begin.begin(), begin.end() - 1);
+        for (int u = 0; u < n; u++) {
+            at[u] = fill[deg[u]]++;
+            order[at[u]] = u;
+        }
+    }
+
+    auto lose = [&](int w, int i) {
+        // only nodes still behind the cursor are alive, and none drops below the current degree
+        if (at[w] <= i || deg[w] <= deg[order[i]]) return;
+        int d = deg[w], first = max(begin[d], i + 1);
+        int x = order[first];
+        swap(order[at[w]], order[first]);
+        swap(at[x], at[w]);
+        begin[d] = first + 1;
+        deg[w]--;
+    };
+
+    int k = 0;
+    for (int i = 0; i < n; i++) {
+        int u = order[i];
+        k = max(k, deg[u]);
+        core[u] = k;
+        if (u < nElems) {
+            for (int s : hg.incident(u + 1)) lose(nElems + s, i);
+        } else {
+            for (int v : hg.edge(u - nElems)) lose(v - 1, i);
+        }
+    }
+    return core;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <vector>
+#include "hypergraph.h"
+
+// core numbers of the bipartite incidence graph, numbered as it used to be built for NetworKit:
+// node v - 1 is element v, node elems() + s is hyperedge s. An element listed twice in a
+// hyperedge is a double edge, as with NetworKit's addEdge
+std::vector<int> core_numbers(const Hypergraph &hg);
@@ -1,9 +1,24 @@
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 #include "pace.h"
+#include "parallel.h"
+#include "deadline.h"
 
 using namespace std; 
 
-int main(){ 
-	init(); 
+// usage: pace [-t threads] [--time seconds] [--model file.onnx] [--native-forest] [input]
+// without --time the search runs until SIGTERM or SIGINT, then the best solution is printed
+int main(int argc, char **argv){ 
+	const char *path = nullptr; 
+	stop_on_signals(); 
+	for(int i = 1; i < argc; i++){
+		if(!strcmp(argv[i], "-t") && i + 1 < argc) set_threads(atoi(argv[++i])); 
+		else if(!strcmp(argv[i], "--time") && i + 1 < argc) set_deadline(atof(argv[++i])); 	//counted from the start, all phases included
+		else if(!strcmp(argv[i], "--model") && i + 1 < argc) use_model_file(argv[++i]); 
+		else if(!strcmp(argv[i], "--native-forest")) use_native_forest(true); 
+		else path = argv[i]; 
+	}
+	init(path); 
 	return 0; 
 }
\ No newline at end of file
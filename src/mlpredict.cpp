@@ -2,6 +2,7 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm> // For std::max_element
+#include <cmath>
 
 MLPredictor::MLPredictor(const std::string& model_path)
     : env(ORT_LOGGING_LEVEL_WARNING, "MLPredictor") {
@@ -27,6 +28,30 @@ MLPredictor::MLPredictor(const std::string& model_path)
     for (const auto& name : output_names_str) {
         output_names_char.push_back(name.c_str());
     }
+
+    memory_info = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+    if (input_shape.size() >= 2 && input_shape[1] > 0) n_features = input_shape[1];
+    // the class count is not always fixed in the graph; one probe row settles it
+    n_classes = predict(std::vector<float>(n_features ? n_features : 8, 0.0f)).probabilities.size();
+    if (!n_features) n_features = 8;
+    check_batch();
+}
+
+// predict_batch writes straight into the caller's buffers, a chunk at a time: a few rows over
+// chunks of 2, the last one short, have to come out as they do one by one
+void MLPredictor::check_batch() {
+    const size_t n = 5;
+    std::vector<float> rows(n * n_features);
+    for (size_t i = 0; i < rows.size(); i++) rows[i] = (float) ((i * 7) % 11);
+    std::vector<int64_t> labels(n);
+    std::vector<float> probs(n * n_classes);
+    predict_batch(rows.data(), n, labels.data(), probs.data(), 2);
+    for (size_t r = 0; r < n; r++) {
+        PredictionResult one = predict(std::vector<float>(rows.begin() + r * n_features, rows.begin() + (r + 1) * n_features));
+        bool same = one.label == labels[r] && one.probabilities.size() == n_classes;
+        for (size_t c = 0; same && c < n_classes; c++) same = std::abs(one.probabilities[c] - probs[r * n_classes + c]) <= 1e-5f;
+        if (!same) throw std::runtime_error("batched predictions differ from single ones for row " + std::to_string(r));
+    }
 }
 
 PredictionResult MLPredictor::predict(const std::vector<float>& input_data) {
@@ -70,4 +95,23 @@ PredictionResult MLPredictor::predict(const std::vector<float>& input_data) {
     result.probabilities.assign(proba_data, proba_data + num_classes);
 
     return result;
+}
+
+void MLPredictor::predict_batch(const float* rows, size_t n, int64_t* labels, float* probs, size_t chunk) {
+    const char* input_names_c_str[] = {input_name.c_str()};
+    for (size_t lo = 0; lo < n; lo += chunk) {
+        int64_t m = (int64_t) std::min(chunk, n - lo);
+        int64_t in_dims[] = {m, (int64_t) n_features};
+        int64_t label_dims[] = {m};
+        int64_t proba_dims[] = {m, (int64_t) n_classes};
+
+        // outputs are bound to the caller's buffers, so nothing is copied back
+        Ort::Value io[] = {
+            Ort::Value::CreateTensor<float>(memory_info, const_cast<float*>(rows + lo * n_features), m * n_features, in_dims, 2),
+            Ort::Value::CreateTensor<int64_t>(memory_info, labels + lo, m, label_dims, 1),
+            Ort::Value::CreateTensor<float>(memory_info, probs + lo * n_classes, m * n_classes, proba_dims, 2),
+        };
+        session->Run(Ort::RunOptions{nullptr}, input_names_c_str, &io[0], 1,
+                     output_names_char.data(), &io[1], 2);
+    }
 }
\ No newline at end of file
@@ -4,20 +4,23 @@
 #include <vector>
 #include <memory> 
 #include <onnxruntime_cxx_api.h> 
+#include "predictor.h"
 
-struct PredictionResult {
-    int64_t label; 
-    std::vector<float> probabilities; 
-};
 
-
-class MLPredictor {
+class MLPredictor : public Predictor {
 public:
     MLPredictor(const std::string& model_path);
 
     ~MLPredictor() = default;
 
-    PredictionResult predict(const std::vector<float>& input_data);
+    PredictionResult predict(const std::vector<float>& input_data) override;
+
+    // one session run per `chunk` rows
+    void predict_batch(const float* rows, size_t n, int64_t* labels, float* probs) override { predict_batch(rows, n, labels, probs, 65536); }
+    void predict_batch(const float* rows, size_t n, int64_t* labels, float* probs, size_t chunk);
+
+    size_t num_features() const override { return n_features; }
+    size_t num_classes() const override { return n_classes; }
 
 private:
     Ort::Env env;
@@ -28,4 +31,9 @@ private:
     std::vector<int64_t> input_shape;
     std::vector<const char*> output_names_char;
     std::vector<std::string> output_names_str;
+    Ort::MemoryInfo memory_info{nullptr};
+    size_t n_features = 0, n_classes = 0;
+
+    // throws if predict_batch disagrees with predict
+    void check_batch();
 };
\ No newline at end of file
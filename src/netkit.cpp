@@ -3,7 +3,7 @@
 using namespace std;
 
 NetworKit::Graph G(1, false, false);
-vector<NetworKit::count> coreNumbers;
+vector<NetworKit::count> nkCoreNumbers;
 
 void run() {
     NetworKit::count n = G.numberOfNodes();
@@ -11,5 +11,8 @@ void run() {
     // Core Decomposition
     NetworKit::CoreDecomposition coreDecomp(G);
     coreDecomp.run();
-    coreNumbers = coreDecomp.getPartition().getVector();
+    nkCoreNumbers = coreDecomp.getPartition().getVector();
+
+    // the graph is only needed for the decomposition, not during the local search
+    G = NetworKit::Graph(1, false, false);
 }
@@ -7,7 +7,7 @@
 
 
 extern NetworKit::Graph G;
-extern std::vector<NetworKit::count> coreNumbers;
+extern std::vector<NetworKit::count> nkCoreNumbers;
 extern double norm;
 
 void run();
\ No newline at end of file
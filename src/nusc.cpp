@@ -1,30 +1,97 @@
 #include "wscp.h"
+#include "parallel.h"
+#include "deadline.h"
+#include "greedy.h"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cmath>
 #include <ctime>
+#include <mutex>
+#include <numeric>
 
-using namespace std; 
+using namespace std;
 
-void produce_tc(vector<vector<int>> &notun, int &updElem, int &updSet){
-    cout<<updElem<<" "<<updSet<<"\n";
-    for(int i = 0; i < updSet; i++) cout<<"1 ";
-    cout<<"\n"; 
-    for(int i = 0; i < updElem; i++){
-        int nS = notun[i].size(); 
-        cout<<nS<<endl; 
-        for(int j = 0; j < nS; j++){
-            cout<<notun[i][j]<<" "; 
+void produce_tc(const Hypergraph &notun){
+    cout<<notun.sets()<<" "<<notun.elems()<<"\n";
+    for(int i = 0; i < notun.elems(); i++) cout<<"1 ";
+    cout<<"\n";
+    for(int i = 0; i < notun.sets(); i++){
+        cout<<notun.edge_size(i)<<endl;
+        for(int r: notun.edge(i)){
+            cout<<r<<" ";
         }
-        cout<<endl; 
+        cout<<endl;
     }
 
 }
 
-void run_nusc(vector<vector<int>> &notun, vector<int> &res, int &updElem, int &updSet, int &remaining){
-    double var_num = (double) updElem, set_num = (double) updSet;
+// components with at most this many elements are solved exactly
+const int exact_elems = 16;
 
-    int time_limit = remaining;
-    WSCP wscp_solver(time_limit);
-    int seed = time(NULL);           
-    srand(seed);
+// the time the stall of a search, and the shares of components queued behind others, are
+// measured against when only a signal will end the search
+const double nominal_secs = 290;
+
+// the settings of the portfolio searches relative to the tuned ones: factors for the weight and
+// the novelty probability, an offset for the tabu length. The first search runs them as tuned
+const struct { double weight, novelty; int tabu; } variation[] = {
+    {1, 1, 0}, {1, 0.5, 0}, {1, 2, 0}, {0.5, 1, 1}, {2, 1, -1}, {1, 1, 2}, {0.5, 0.5, 0}, {2, 2, 1},
+};
+
+// the best distinct solutions the searches of a portfolio have published, at most cap, cheapest
+// first. Searches come by once per time check, every thousand steps or so: a lock is cheap enough
+struct Elite {
+    mutex m;
+    size_t cap = 1;
+    vector<pair<long long, vector<int>>> sols;
+
+    void offer(long long cost, const int *solu, int n){
+        lock_guard<mutex> g(m);
+        if(sols.size() == cap && cost >= sols.back().first) return;
+        for(auto &s: sols){
+            if(s.first == cost && equal(solu, solu + n, s.second.begin())) return;
+        }
+        auto at = upper_bound(sols.begin(), sols.end(), cost, [](long long c, const auto &s){ return c < s.first; });
+        sols.insert(at, {cost, vector<int>(solu, solu + n)});
+        if(sols.size() > cap) sols.pop_back();
+    }
+
+    // one of the solutions, the cheaper the likelier; false unless the best beats below
+    bool pick(WSCP &w, long long below, vector<int> &out){
+        lock_guard<mutex> g(m);
+        if(sols.empty() || sols[0].first >= below) return false;
+        size_t i = min(w.rand() % sols.size(), w.rand() % sols.size());
+        out = sols[i].second;
+        return true;
+    }
+};
+
+// a search whose best has not improved for stall_share of its time, and is behind the elite,
+// restarts from an elite solution with one set in drop_in taken out
+const double stall_share = 1.0 / 10;
+const int drop_in = 200;
+
+// a search starts from one in keep_in of the greedy elements, picked at random, and completes
+// them its own way: from all of them it settles in worse optima
+const int keep_in = 2;
+
+// `searches` NuSC searches of at most secs seconds on their own threads, with different seeds and
+// settings over one reduced instance. They publish their best solutions to an elite pool and
+// restart from it when they stall. They start from parts of the greedy solution, which is also
+// the answer once stopped; res gets the chosen elements of the best, the first found when
+// several end equal
+static void solve_wscp(const Hypergraph &notun, vector<int> &res, double secs, unsigned seed, int searches, bool verbose){
+    double var_num = (double) notun.sets(), set_num = (double) notun.elems();
+
+    auto t0 = chrono::steady_clock::now();
+    vector<int> greedy = greedy_hitting_set(notun);
+    if(verbose) cerr<<"greedy: "<<greedy.size()<<" elements ("<<chrono::duration<double>(chrono::steady_clock::now() - t0).count()<<" s)\n";
+    if(deadline_passed()){
+        res.insert(res.end(), greedy.begin(), greedy.end());
+        return;
+    }
 
     int new_weight, tabu_len;
     double novelty_p;
@@ -41,23 +108,188 @@ void run_nusc(vector<vector<int>> &notun, vector<int> &res, int &updElem, int &u
         else novelty_p = 0.5;
     }
 
-    wscp_solver.build_instance(notun, updElem, updSet);
-    cerr<<"NuSC build: complete\n";
-    wscp_solver.reduce_instance();
-    cerr<<"NuSC reduction: complete\n";
-    wscp_solver.set_param(new_weight, tabu_len, novelty_p);
-    
-    start_timing();
-    wscp_solver.init();
-    cerr<<"NuSC init: complete\n";
-    wscp_solver.local_search();
-    cerr<<"NuSC local_search: complete\n";
-    wscp_solver.check_solu();
-
-    for (int i = 0; i < wscp_solver.set_num; ++i){
-        if(wscp_solver.best_solu[i] == 1){
+    vector<WSCP> solver;
+    solver.reserve(searches);
+    for(int k = 0; k < searches; k++) solver.emplace_back(secs, seed + 7919 * k);
+    solver[0].build_instance(notun);
+    if(verbose) cerr<<"NuSC build: complete\n";
+    solver[0].reduce_instance();
+    if(verbose) cerr<<"NuSC reduction: complete\n";
+
+    atomic<long long> best{LLONG_MAX};
+    atomic<int> restarts{0};
+    Elite elite;
+    elite.cap = searches;
+    double stall = max(1.0, (isinf(secs) ? nominal_secs : secs) * stall_share);
+    run_parallel(searches, [&](int k){
+        WSCP &wscp_solver = solver[k];
+        if(k) wscp_solver.share_instance(solver[0]);
+        const auto &d = variation[k % size(variation)];
+        wscp_solver.set_param(max(1, (int) lround(new_weight * d.weight)), max(1, tabu_len + d.tabu), min(0.9, novelty_p * d.novelty));
+        wscp_solver.global_best = &best;
+        if(searches > 1) wscp_solver.exchange = [&, published = (long long) LLONG_MAX, since = 0.0, x = vector<int>()](WSCP &w) mutable {
+            if(w.best_cost < published){
+                published = w.best_cost;
+                elite.offer(w.best_cost, w.best_solu, w.set_num);
+            }
+            double now = w.get_runtime();
+            if(now - max(w.best_time, since) < stall || !elite.pick(w, w.best_cost, x)) return;
+            since = now;
+            for(int i = 0; i < w.set_num; i++){
+                if(x[i] == 1 && !w.fix[i] && w.rand() % drop_in == 0) x[i] = 0;
+            }
+            w.load_solu(x.data());
+            restarts++;
+        };
+        vector<int> start(notun.elems(), 0);
+        for(int v: greedy) start[v - 1] = wscp_solver.rand() % keep_in == 0;
+        wscp_solver.start_timing();
+        wscp_solver.init(start.data());
+        wscp_solver.local_search();
+    });
+    int w = 0;
+    for(int k = 1; k < searches; k++){
+        if(solver[k].best_cost < solver[w].best_cost) w = k;
+    }
+    if(verbose){
+        cerr<<"NuSC local_search: complete";
+        if(searches > 1){
+            cerr<<", best "<<best.load()<<" from search "<<w<<" of "<<searches<<" (";
+            for(int k = 0; k < searches; k++) cerr<<(k ? " " : "")<<solver[k].best_cost;
+            cerr<<"), "<<restarts<<" restarts from the elite";
+        }
+        cerr<<"\n";
+    }
+    solver[w].check_solu();
+
+    for (int i = 0; i < solver[w].set_num; ++i){
+        if(solver[w].best_solu[i] == 1){
             res.push_back(i + 1);
         }
     }
-    wscp_solver.free_memory();
+    // the first owns the instance the others share
+    for(int k = searches - 1; k >= 0; k--) solver[k].free_memory();
+}
+
+// minimum hitting set of at most exact_elems elements, edges given as bit masks: branches on the
+// elements of the smallest edge not hit yet, with the best set so far as the bound. That takes
+// microseconds, so it is not cut short by the deadline
+static uint32_t solve_exact(const vector<uint32_t> &edges, int n){
+    uint32_t best = n == 32 ? ~0u : (1u << n) - 1;
+    int bestk = n;
+    auto branch = [&](auto &&self, uint32_t chosen, int k) -> void {
+        uint32_t pick = 0;
+        for (uint32_t e : edges) {
+            if (!(e & chosen) && (!pick || popcount(e) < popcount(pick))) pick = e;
+        }
+        if (!pick) {
+            best = chosen, bestk = k;
+            return;
+        }
+        if (k + 1 >= bestk) return;
+        for (uint32_t r = pick; r; r &= r - 1) self(self, chosen | (r & -r), k + 1);
+    };
+    branch(branch, 0, 0);
+    return best;
+}
+
+static int find_root(vector<int> &parent, int x){
+    while(parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+// the components of notun are independent problems: tiny ones are solved exactly up front, the
+// others get their own NuSC on a pool of thread_count() workers, largest first, with a share of
+// the time proportional to their incidences. A single component, or the largest, runs a
+// portfolio of searches on the workers left over. The solutions are put together in res
+void run_nusc(const Hypergraph &notun, vector<int> &res, double remaining){
+    auto start = chrono::steady_clock::now();
+    int n = notun.elems(), m = notun.sets();
+    vector<int> parent(n + 1);
+    iota(parent.begin(), parent.end(), 0);
+    for(int s = 0; s < m; s++){
+        auto e = notun.edge(s);
+        for(int v: e) parent[find_root(parent, v)] = find_root(parent, e[0]);
+    }
+
+    // elements without an edge belong to no component
+    struct Part { vector<int> elems; CSR edges; size_t inc = 0; };
+    vector<int> comp(n + 1, -1), local(n + 1);
+    vector<Part> parts;
+    for(int s = 0; s < m; s++){
+        auto e = notun.edge(s);
+        if(e.empty()) continue;
+        int &c = comp[find_root(parent, e[0])];
+        if(c < 0) c = (int) parts.size(), parts.emplace_back();
+    }
+    int workers = thread_count();
+    if(parts.size() <= 1){
+        // a single component needs no copy
+        solve_wscp(notun, res, remaining, time(NULL), workers, true);
+        return;
+    }
+    for(int v = 1; v <= n; v++){
+        int c = comp[find_root(parent, v)];
+        if(c < 0) continue;
+        local[v] = (int) parts[c].elems.size() + 1;
+        parts[c].elems.push_back(v);
+    }
+    for(int s = 0; s < m; s++){
+        auto e = notun.edge(s);
+        if(e.empty()) continue;
+        Part &p = parts[comp[find_root(parent, e[0])]];
+        for(int v: e) p.edges.ids.push_back(local[v]);
+        p.edges.end_row();
+        p.inc += e.size();
+    }
+    // the searched components come first, largest first
+    auto searched_first = [](const Part &p){ return (int) p.elems.size() > exact_elems; };
+    sort(parts.begin(), parts.end(), [&](const Part &a, const Part &b){
+        return searched_first(a) != searched_first(b) ? searched_first(a) : a.inc > b.inc;
+    });
+
+    int exact = 0;
+    size_t searched = 0;
+    for(const Part &p: parts){
+        if(searched_first(p)) searched += p.inc;
+        else exact++;
+    }
+    // workers the pool would leave idle run extra searches on the largest component
+    int nusc = (int) parts.size() - exact;
+    int first = max(1, workers - max(nusc - 1, 0));
+    int pool = min(workers - (first - 1), nusc);
+    cerr<<"components: "<<parts.size()<<", "<<exact<<" solved exactly, "<<parts.size() - exact
+        <<" by NuSC; the largest has "<<parts[0].elems.size()<<" elements and "<<parts[0].edges.rows()<<" hyperedges\n";
+
+    vector<vector<int>> sol(parts.size());
+    // the exact components come before any search, which might leave them no time at all
+    for(size_t i = nusc; i < parts.size(); i++){
+        Part &p = parts[i];
+        vector<uint32_t> masks;
+        for(int s = 0; s < p.edges.rows(); s++){
+            uint32_t x = 0;
+            for(int v: p.edges.row(s)) x |= 1u << (v - 1);
+            masks.push_back(x);
+        }
+        for(uint32_t r = solve_exact(masks, (int) p.elems.size()); r; r &= r - 1) sol[i].push_back(p.elems[countr_zero(r)]);
+    }
+    atomic<size_t> next{0};
+    unsigned seed = time(NULL);
+    run_parallel(pool, [&](int){
+        for(size_t i; (i = next.fetch_add(1)) < (size_t) nusc; ){
+            Part &p = parts[i];
+            int k = (int) p.elems.size();
+            // no search runs past the overall deadline, whatever its share
+            double left = remaining - chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            double share = min(1.0, (double) pool * p.inc / searched) * (isinf(remaining) ? nominal_secs : remaining);
+            // only a signal ends an unbounded run, whatever the number of components: the last
+            // component a worker takes searches until then, those before it move the queue on
+            if(isinf(remaining) && next.load() >= (size_t) nusc) share = INFINITY;
+            vector<int> r;
+            solve_wscp(Hypergraph(k, move(p.edges)), r, max(0.0, min(share, left)), seed + i, i ? 1 : first, i == 0);
+            for(int v: r) sol[i].push_back(p.elems[v - 1]);
+        }
+    });
+    for(auto &s: sol) res.insert(res.end(), s.begin(), s.end());
+    cerr<<"components solved: "<<res.size()<<" elements ("<<chrono::duration<double>(chrono::steady_clock::now() - start).count()<<" s)\n";
 }
@@ -1,6 +1,9 @@
 #include <vector>
+#include "hypergraph.h"
 
 using namespace std; 
 
-void produce_tc(vector<vector<int>> &notun, int &updElem, int &updSet); 
-void run_nusc(vector<vector<int>> &notun, vector<int> &res, int &updElem, int &updSet, int &remaining);
\ No newline at end of file
+void produce_tc(const Hypergraph &notun); 
+// searches until remaining seconds have passed or the deadline flag goes up (deadline.h); an
+// infinite remaining leaves it to the flag
+void run_nusc(const Hypergraph &notun, vector<int> &res, double remaining);
\ No newline at end of file
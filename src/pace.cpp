@@ -4,13 +4,30 @@
 #include <string>
 #include <chrono>
 #include <unordered_set>
-#include <unordered_map>
+#include <memory>
+#include <cmath>
+#include <stdexcept>
 
+#include "hypergraph.h"
+#include "parser.h"
+#include "hgb.h"
 #include "graph.h"
-#include "netkit.h"
+#include "predictor.h"
+#include "forest.h"
+#ifdef PACE_ONNXRUNTIME
 #include "mlpredict.h"
+#endif
+#ifdef PACE_EMBEDDED_MODEL
+#include "compiled_forest.h"
+#endif
+#include <unistd.h>
+#include <climits>
+#include <cstring>
 #include "prune.h"
+#include "reduce.h"
 #include "nusc.h"
+#include "deadline.h"
+#include "greedy.h"
 
 #define el <<"\n"
 #define sp <<" "
@@ -19,50 +36,51 @@
 using namespace std;
 
 int nElems, nSets, updElem, updSet;
-vector<vector<int>> sets, notun; 
-vector<unordered_set<int>> member;
-unordered_map<int, int> mapp, rmapp;
+Hypergraph hg, notun; 
+vector<int> rmapp;
 vector<int> res, inc; 
 unordered_set<int> final;
+vector<int> incumbent; 			//greedy solution of the whole input, printed if nothing better comes of the rest
+bool native_forest = false; 
+string model_file; 
 
-void loadInp(){
-	string dumm, str;
-	getline(cin, str);
+void loadInp(const char *path){
+	auto start = std::chrono::high_resolution_clock::now();
 	{
-		stringstream ss(str); 
-		ss>>dumm>>dumm>>nElems>>nSets; 
-	}
-	member.resize(nElems + 1); 
-	int ind = 0;
-	while(getline(cin, str)){
-		stringstream ss(str);
-		int x; 
-		vector<int> temp;
-		while(ss>>x){
-			//x = (x == n ? 0 : x); 
-			temp.push_back(x);
-			member[x].insert(ind); 
+		auto inp = make_shared<InputBuffer>(path);
+		bool cached = is_hgb(inp->data(), inp->size()); 
+		if(cached){
+			hg = load_hgb(inp->data(), inp->size(), inp); 		//arrays are used in place, inp stays mapped
+			nElems = hg.elems(); 
+		}
+		else{
+			CSR sets;
+			parse_hgr(inp->data(), inp->size(), nElems, nSets, sets);
+			hg = Hypergraph(nElems, std::move(sets));
 		}
-		sets.push_back(temp);
-		ind++; 
+		auto finish = std::chrono::high_resolution_clock::now();
+		double secs = std::chrono::duration<double>(finish - start).count();
+		cerr<<(cached ? "loaded cached " : "parsed ")<<inp->size() / 1048576.0<<" MB in "<<secs<<" s ("<<inp->size() / 1048576.0 / max(secs, 1e-9)<<" MB/s)\n";
 	}
+	nSets = hg.sets(); 		//trust the lines actually present over the header
 }
 
-template <typename T>
-float to_float(T value) {
-    return static_cast<float>(value);
+const float *get_vector(size_t k){
+	return features.data() + k * NUM_FEATURES; 
 }
 
 void generate_csv(double t_limit){
-	loadInp();
+	loadInp(nullptr);
 	auto start = std::chrono::high_resolution_clock::now();
-	build_graph(sets, nElems);
+	vector<int> all(nElems); 
+	for(int i = 0; i < nElems; i++) all[i] = i + 1; 
+	build_graph(hg, all);
 
 	auto finish = std::chrono::high_resolution_clock::now();
 	double secs = std::chrono::duration<double>(finish - start).count();
 	cerr<<"time taken = "<<secs<<endl; 
-	int lim = floor(t_limit);
-	run_nusc(sets, res, nSets, nElems, lim);
+	set_deadline(t_limit); 
+	run_nusc(hg, res, t_limit);
 
 	inc.resize(nElems + 1, 0); 
 	for(int r: res) inc[r] = 1;  
@@ -70,102 +88,209 @@ void generate_csv(double t_limit){
 	cout<<fixed <<setprecision(6);
 	for(int i = 1; i <= nElems; i++){
 		//cout<<i<<"\t";
-		cout<<deg_elem[i]<<",";
-		cout<<deg_set[i]<<",";
-		cout<<min_deg[i]<<","; 
-		cout<<max_deg[i]<<",";
-		cout<<sum_nei_degree[i]<<",";
-		cout<<avg_deg[i]<<","; 
-		cout<<smooth(lcc[i])<<",";
-		cout<<coreNumbers[i - 1]<<",";
+		const float *f = get_vector(i - 1); 
+		for(int k = 0; k < CORE; k++) cout<<f[k]<<","; 
+		cout<<(int) f[CORE]<<",";
 		cout<<inc[i]<<"\n";
 	}
 }
 
-vector<float> get_vector(int r){
-	vector<float> ans = {
-		to_float(deg_elem[r]), to_float(deg_set[r]), to_float(min_deg[r]), to_float(max_deg[r]), to_float(sum_nei_degree[r]), 
-		to_float(avg_deg[r]), to_float(smooth(lcc[r])), to_float(coreNumbers[r])
-	};
-	return ans; 
-}
-
 
 void do_mapping(){
-	updElem = 0; 
-	int idx = 1; 
-	for(int i = 1; i <= nElems; i++){
-		if(!delElem[i]){
-			mapp[i] = idx; 
-			rmapp[idx] = i; 
-			idx++; 
-			updElem++; 
-		}
-	}
-
-    updSet = 0;
-    for (int i = 0; i < nSets; i++) {
-        if (!delSet[i]) {
-            vector<int> temp;
-            for(int r: sets[i]){
-            	if(!delElem[r]){
-            		temp.push_back(mapp[r]); 
-            	}
-            }
-            notun.push_back(temp); 
-            updSet++; 
-        }
-    }
+	merge_twins(hg, delSet, delElem); 		//one element per class of equal incidence goes to NuSC
+	notun = hg.project(delElem, delSet, rmapp); 
+	updElem = notun.elems(); 
+	updSet = notun.sets(); 
 }
 
 void show(){
 	cout<<updElem sp<<updSet el; 
-	for(auto v: notun){
-		cout<<v.size() el; 
-		for(int r: v) cout<<r sp; cout el; 
+	for(int i = 0; i < notun.sets(); i++){
+		cout<<notun.edge_size(i) el; 
+		for(int r: notun.edge(i)) cout<<r sp; cout el; 
 	}
 }
 
 
+// a twin left out by do_mapping is covered by its representative, which rmapp gives back as is
 void mergeFromNuSC() {
     for (int r : res) {
     	final.insert(rmapp[r]);         
     }
 }
 
+// the solution is checked against the input before it is printed: an edge left unhit by a phase
+// that was cut short gets its first element, so what comes out is always a hitting set
+static void repair(){
+	vector<char> in(nElems + 1, 0); 
+	for(int v: final) in[v] = 1; 
+	int added = 0; 
+	for(int s = 0; s < hg.sets(); s++){
+		auto e = hg.edge(s); 
+		if(e.empty() || ranges::any_of(e, [&](int v){ return in[v]; })) continue; 
+		in[e[0]] = 1; 
+		final.insert(e[0]); 
+		added++; 
+	}
+	if(added) cerr<<"repair: "<<added<<" hyperedges were not hit, added an element of each\n"; 
+}
+
 void printResult(){
+	repair(); 
+	if(incumbent.size() && incumbent.size() < final.size()){
+		cerr<<"keeping the greedy solution, "<<incumbent.size()<<" instead of "<<final.size()<<" elements\n"; 
+		final = unordered_set<int>(incumbent.begin(), incumbent.end()); 
+	}
 	cout<<final.size() el; 
 	for(int r: final) cout<<r el; 
 	return; 
 }
 
-void init(){
-	loadInp(); 
-	auto start = std::chrono::high_resolution_clock::now();
-	build_graph(sets, nElems); 
-	    
-	double lim = 290; 
+void use_native_forest(bool on){
+	native_forest = on; 
+}
+
+void use_model_file(const char *path){
+	model_file = path; 
+}
+
+// rf_model.onnx of the source tree, found from the executable (build/pace) rather than the working directory
+static string default_model_file(){
+	char buf[PATH_MAX]; 
+	ssize_t len = readlink("/proc/self/exe", buf, sizeof(buf) - 1); 
+	if(len <= 0) return "../rf_model.onnx"; 
+	string exe(buf, len); 
+	return exe.substr(0, exe.rfind('/') + 1) + "../rf_model.onnx"; 
+}
+
+// the compiled-in model unless a model file was given, then onnxruntime unless the native
+// forest was asked for or ORT is not built in
+unique_ptr<Predictor> make_predictor(){
+#ifdef PACE_EMBEDDED_MODEL
+	if(model_file.empty()){
+		auto c = make_unique<CompiledForest>(); 
+		cerr<<"compiled forest: "<<c->num_trees()<<" trees, "<<c->num_nodes()<<" nodes\n"; 
+		return c; 
+	}
+#endif
+	string path = model_file.empty() ? default_model_file() : model_file; 
+#ifdef PACE_ONNXRUNTIME
+	if(!native_forest) return make_unique<MLPredictor>(path); 
+#endif
+	auto f = make_unique<Forest>(path); 
+	cerr<<"native forest: "<<f->num_trees()<<" trees, "<<f->num_nodes()<<" nodes\n"; 
+	return f; 
+}
+
+// make_predictor, or nothing when the model cannot be loaded (a Git LFS pointer, a missing file)
+// or does not take the features computed here
+static unique_ptr<Predictor> load_model(){
+	try{
+		unique_ptr<Predictor> model = make_predictor(); 
+		size_t nf = model->num_features(); 
+		if(nf != (size_t) NUM_FEATURES) throw runtime_error("model expects " + to_string(nf) + " features, " + to_string(NUM_FEATURES) + " are computed"); 
+		return model; 
+	}
+	catch(const exception &e){
+		cerr<<"no predictions, the model cannot be used: "<<e.what()<<"\n"; 
+		return nullptr; 
+	}
+}
+
+// distinct rows of an n x nf matrix, compared bit for bit: uniq receives every distinct row once
+// and of[i] is the position of row i in it
+static size_t dedup_rows(const float *rows, size_t n, size_t nf, vector<float> &uniq, vector<int> &of){
+	size_t cap = 1, bytes = nf * sizeof(float); 
+	while(cap < 2 * n) cap <<= 1; 
+	vector<int> slot(cap, -1); 
+	uniq.clear(); 
+	of.resize(n); 
+	for(size_t i = 0; i < n; i++){
+		const float *x = rows + i * nf; 
+		uint64_t h = 0; 
+		for(size_t k = 0; k < nf; k++){
+			uint32_t b; 
+			memcpy(&b, x + k, sizeof b); 
+			h = (h ^ b) * 0x9E3779B97F4A7C15ull; 
+		}
+		size_t s = (h ^ h >> 32) & (cap - 1); 
+		while(slot[s] >= 0 && memcmp(uniq.data() + (size_t) slot[s] * nf, x, bytes)) s = (s + 1) & (cap - 1); 
+		if(slot[s] < 0){
+			slot[s] = (int) (uniq.size() / nf); 
+			uniq.insert(uniq.end(), x, x + nf); 
+		}
+		of[i] = slot[s]; 
+	}
+	return uniq.size() / nf; 
+}
+
+// everything after the greedy solution: reductions, predictions, pruning and NuSC, whose solution
+// ends up in final
+static void search(std::chrono::high_resolution_clock::time_point start){
+	// the kernel is what the predictions and pruning start from
+	Reduction red = reduce(hg); 
+	for(int v: red.forced) final.insert(v); 
+	delElem = red.delElem; 
+	delSet = red.delSet; 
+
     float one_thresh = 0.95, zero_thresh = 0.95;
 
-    MLPredictor model("../rf_model.onnx");
-    for(int i = 1; i <= nElems; i++){
-        vector<float> input_vec = get_vector(i);
-        PredictionResult result = model.predict(input_vec);
-        pair<int, float> pp = {i, result.probabilities[result.label]};
-        if(result.label == 0 && pp.second >= zero_thresh) add_zero(pp);
-        else if(result.label == 1 && pp.second >= one_thresh) add_one(pp); 
+    // once stopped, or without a usable model, the search starts from the kernel as it is
+    unique_ptr<Predictor> pmodel; 
+    if(deadline_passed()) cerr<<"stopped: no features and predictions\n"; 
+    else if((pmodel = load_model())){
+        build_graph(hg, red.undecided); 
+        Predictor &model = *pmodel; 
+        size_t nf = model.num_features(), nc = model.num_classes(); 
+        // elements with the same degree pattern share one prediction
+        vector<float> uniq; 
+        vector<int> of; 
+        size_t rows = red.undecided.size(); 
+        size_t nu = dedup_rows(features.data(), rows, nf, uniq, of); 
+        cerr<<"dedup: "<<nu<<" distinct feature rows of "<<rows<<" ("<<(nu ? (double) rows / nu : 1.0)<<"x)\n"; 
+        vector<int64_t> labels(nu); 
+        vector<float> proba(nu * nc); 
+        // rows that cannot reach a threshold come back as label -1
+        size_t skipped = model.predict_confident(uniq.data(), nu, zero_thresh, one_thresh, labels.data(), proba.data()); 
+        if(model.num_trees()) cerr<<"early exit skipped "<<skipped<<" of "<<nu * model.num_trees()<<" tree evaluations\n"; 
+        for(size_t k = 0; k < rows; k++){
+            size_t u = of[k]; 
+            int64_t label = labels[u]; 
+            if(label < 0) continue; 
+            pair<int, float> pp = {red.undecided[k], proba[u * nc + label]};
+            if(label == 0 && pp.second >= zero_thresh) add_zero(pp);
+            else if(label == 1 && pp.second >= one_thresh) add_one(pp); 
+        }
+        cerr<<"prediction done\n";
     }
-    cerr<<"prediction done\n";
-    prune(sets, member, final, nElems); 
+    prune(hg, final); 
     do_mapping();
    	cerr<<"pruning and mapping done\n"; 
     auto finish = std::chrono::high_resolution_clock::now();
 	double secs = std::chrono::duration<double>(finish - start).count();
-	int remaining =  max((int ) floor(lim - secs), 15);
+	double remaining = deadline_left();
 	//show();
-	cerr<<"running nusc for "<<remaining<<" seconds\n"; 
-	run_nusc(notun, res, updSet, updElem, remaining); 
+	if(isinf(remaining)) cerr<<"running nusc until signalled ("<<secs<<" s before)\n"; 
+	else cerr<<"running nusc for "<<remaining<<" seconds\n"; 
+	run_nusc(notun, res, remaining); 
 	mergeFromNuSC();
-	printResult();
-	return; 
+}
+
+void init(const char *path){
+	loadInp(path); 
+	auto start = std::chrono::high_resolution_clock::now();
+	// from here on there is an answer, however early the run is stopped or whatever fails later
+	incumbent = greedy_hitting_set(hg); 
+	cerr<<"greedy: "<<incumbent.size()<<" elements ("<<std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count()<<" s)\n"; 
+	if(deadline_passed()) final.insert(incumbent.begin(), incumbent.end()); 
+	else{
+		try{
+			search(start); 
+		}
+		catch(const exception &e){
+			cerr<<"search failed: "<<e.what()<<", printing the greedy solution\n"; 
+			final = unordered_set<int>(incumbent.begin(), incumbent.end()); 
+		}
+	}
+	printResult(); 
 }
@@ -1,15 +1,17 @@
 #include <string>
 #include <vector>
+#include <memory>
+#include "predictor.h"
 
 using namespace std; 
 
-template <typename T>
-float to_float(T value);
-
-void loadInp(); 
+void loadInp(const char *path = nullptr); 					//reads stdin when no path is given
 void generate_csv(double t_limit); 				//this is used to generate datasets from the public instances. 
-std::vector<float> get_vector(int r);
+const float *get_vector(size_t k); 				//row k of the feature matrix
 void do_mapping(); 
 void mergeFromNuSC(); 
 void printResult(); 
-void init(); 
\ No newline at end of file
+void use_native_forest(bool on); 				//evaluate a model file with Forest instead of onnxruntime
+void use_model_file(const char *path); 			//load this .onnx instead of the compiled-in model
+unique_ptr<Predictor> make_predictor(); 
+void init(const char *path = nullptr); 
\ No newline at end of file
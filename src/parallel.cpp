@@ -0,0 +1,13 @@
+#include "parallel.h"
+
+static int nThreads = 0;
+
+void set_threads(int t) {
+    nThreads = t;
+}
+
+int thread_count() {
+    if (nThreads > 0) return nThreads;
+    int hw = (int) std::thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// worker count for the parallel phases, set from the command line; 0 = all hardware threads
+void set_threads(int t);
+int thread_count();
+
+// runs f(0) .. f(parts - 1) concurrently, f(0) on the calling thread; f must not throw
+template <class F>
+void run_parallel(int parts, F &&f) {
+    std::vector<std::thread> pool;
+    for (int i = 1; i < parts; i++) pool.emplace_back([&f, i] { f(i); });
+    if (parts > 0) f(0);
+    for (auto &t : pool) t.join();
+}
+
+// splits [lo, hi) into one contiguous range per worker, ranges of fewer than `grain` items are
+// not worth a thread; runs f(begin, end) for each. f must not throw
+template <class F>
+void parallel_for(long lo, long hi, F &&f, long grain = 1 << 14) {
+    long n = hi - lo;
+    int parts = (int) std::max(1L, std::min<long>(thread_count(), n / grain));
+    run_parallel(parts, [&](int p) { f(lo + n * p / parts, lo + n * (p + 1) / parts); });
+}
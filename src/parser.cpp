@@ -0,0 +1,179 @@
+#include "parser.h"
+#include "parallel.h"
+
+#include <stdexcept>
+#include <string>
+#include <exception>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const size_t BLOCK = 1 << 24;
+static const size_t PARALLEL_MIN = 1 << 23;		// smaller bodies are not worth the threads
+
+InputBuffer::InputBuffer(const char *path) {
+	int fd = 0;
+	if (path) {
+		fd = open(path, O_RDONLY);
+		if (fd < 0) throw runtime_error(string("cannot open ") + path);
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED) {
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			mapped = p;
+			buf = (const char*) p;
+			len = st.st_size;
+		}
+	}
+
+	if (!mapped) {
+		// pipes and other streams: grow in large blocks
+		size_t got = 0;
+		while (true) {
+			owned.resize(got + BLOCK);
+			ssize_t r = read(fd, owned.data() + got, BLOCK);
+			if (r < 0 && errno == EINTR) continue;		// a stop signal is not the end of the input
+			if (r < 0) {
+				string why = strerror(errno);
+				if (path) close(fd);
+				throw runtime_error(string("cannot read ") + (path ? path : "standard input") + ": " + why);
+			}
+			if (r == 0) break;
+			got += r;
+		}
+		owned.resize(got);
+		buf = owned.data();
+		len = got;
+	}
+	if (path) close(fd);
+}
+
+InputBuffer::~InputBuffer() {
+	if (mapped) munmap(mapped, len);
+}
+
+static inline const char* skip_blank(const char *p, const char *end) {
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+	return p;
+}
+
+static inline const char* skip_line(const char *p, const char *end) {
+	while (p < end && *p != '\n') p++;
+	return p < end ? p + 1 : p;
+}
+
+static inline const char* scan_int(const char *p, const char *end, int &x) {
+	uint64_t v = 0;
+	while (p < end && (unsigned) (*p - '0') < 10) {
+		v = v * 10 + (*p++ - '0');
+		if (v > INT_MAX) throw runtime_error("number out of range");		// would wrap past the range checks
+	}
+	x = (int) v;
+	return p;
+}
+
+// comment lines and the 'p' line; returns the first byte after the header
+static const char* parse_header(const char *p, const char *end, int &nElems, int &nSets) {
+	while (p < end) {
+		p = skip_blank(p, end);
+		if (p == end) break;
+		char ch = *p;
+		if (ch == '\n') { p++; continue; }
+		if (ch == 'c') { p = skip_line(p, end); continue; }
+		if (ch != 'p') throw runtime_error("hyperedge before 'p' line");
+		p++;
+		p = skip_blank(p, end);
+		while (p < end && *p != ' ' && *p != '\t') p++;		// format word, "hs"
+		p = scan_int(skip_blank(p, end), end, nElems);
+		p = scan_int(skip_blank(p, end), end, nSets);
+		return skip_line(p, end);
+	}
+	throw runtime_error("missing 'p' line");
+}
+
+// hyperedge lines of [p, end), which starts at a line boundary
+static void parse_edges(const char *p, const char *end, int nElems, CSR &edges) {
+	while (p < end) {
+		p = skip_blank(p, end);
+		if (p == end) break;
+		char ch = *p;
+		if (ch == '\n') { p++; continue; }
+		if (ch == 'c') { p = skip_line(p, end); continue; }
+
+		while (p < end && *p != '\n') {
+			int x;
+			const char *q = scan_int(p, end, x);
+			if (q == p) throw runtime_error("unexpected character in hyperedge line");
+			if (x < 1 || x > nElems) throw runtime_error("element id out of range");
+			edges.ids.push_back(x);
+			p = skip_blank(q, end);
+		}
+		edges.end_row();
+	}
+}
+
+void parse_hgr(const char *buf, size_t len, int &nElems, int &nSets, CSR &edges, int threads) {
+	const char *end = buf + len;
+	nElems = nSets = 0;
+	edges.clear();
+	const char *p = parse_header(buf, end, nElems, nSets);
+	size_t body = end - p;
+
+	int T = threads > 0 ? threads : thread_count();
+	if (body < PARALLEL_MIN) T = 1;
+	if (T == 1) {
+		edges.off.reserve((size_t) nSets + 1);
+		edges.ids.reserve(body / 4);		// rough bound on the id count, untouched capacity is never paged in
+		parse_edges(p, end, nElems, edges);
+		return;
+	}
+
+	// cut the body at line starts, one chunk per thread
+	vector<const char*> cut(T + 1);
+	cut[0] = p;
+	cut[T] = end;
+	for (int c = 1; c < T; c++) {
+		const char *q = p + body / T * c;
+		if (q < cut[c - 1]) q = cut[c - 1];
+		if (q > p && q[-1] != '\n') q = skip_line(q, end);
+		cut[c] = q;
+	}
+
+	vector<CSR> part(T);
+	vector<exception_ptr> err(T);
+	run_parallel(T, [&](int c) {
+		try {
+			part[c].ids.reserve((cut[c + 1] - cut[c]) / 4);
+			parse_edges(cut[c], cut[c + 1], nElems, part[c]);
+		} catch (...) {
+			err[c] = current_exception();
+		}
+	});
+	for (auto &e : err) if (e) rethrow_exception(e);
+
+	// prefix sums over the chunk sizes place every chunk, keeping the hyperedge order of the file
+	vector<size_t> rowBase(T + 1, 0), idBase(T + 1, 0);
+	for (int c = 0; c < T; c++) {
+		rowBase[c + 1] = rowBase[c] + part[c].rows();
+		idBase[c + 1] = idBase[c] + part[c].ids.size();
+	}
+	edges.off.resize(rowBase[T] + 1);
+	edges.ids.resize(idBase[T]);
+	run_parallel(T, [&](int c) {
+		const CSR &q = part[c];
+		copy(q.ids.begin(), q.ids.end(), edges.ids.begin() + idBase[c]);
+		for (int r = 0; r < q.rows(); r++) edges.off[rowBase[c] + r + 1] = idBase[c] + q.off[r + 1];
+		part[c] = CSR();
+	});
+}
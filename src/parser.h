@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include "hypergraph.h"
+
+// whole input file held in memory: mmap'd when it is a regular file, read in blocks otherwise
+class InputBuffer {
+public:
+    explicit InputBuffer(const char *path = nullptr);	// nullptr reads stdin
+    ~InputBuffer();
+    InputBuffer(const InputBuffer&) = delete;
+    InputBuffer& operator=(const InputBuffer&) = delete;
+
+    const char *data() const { return buf; }
+    size_t size() const { return len; }
+
+private:
+    const char *buf = nullptr;
+    size_t len = 0;
+    void *mapped = nullptr;
+    std::vector<char> owned;
+};
+
+// parses "p hs <nElems> <nSets>" followed by one hyperedge per line, 'c' lines are comments.
+// Large inputs are split at line boundaries and parsed by `threads` workers (0 = thread_count())
+void parse_hgr(const char *buf, size_t len, int &nElems, int &nSets, CSR &edges, int threads = 0);
@@ -0,0 +1,36 @@
+#pragma once 
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct PredictionResult {
+    int64_t label; 
+    std::vector<float> probabilities; 
+};
+
+// common face of the ONNX Runtime session and the native forest, so init() can use either
+class Predictor {
+public:
+    virtual ~Predictor() = default;
+
+    virtual PredictionResult predict(const std::vector<float>& input_data) = 0;
+
+    // n rows of num_features() floats, row-major. labels[n] and probs[n * num_classes()] are
+    // written in place
+    virtual void predict_batch(const float* rows, size_t n, int64_t* labels, float* probs) = 0;
+
+    // predict_batch for callers that only keep label 0 with probability >= zero_thresh and label 1
+    // with probability >= one_thresh: a row that can no longer get there may be given label -1
+    // early, every other row is exact. Returns the tree evaluations skipped that way
+    virtual size_t predict_confident(const float* rows, size_t n, float /*zero_thresh*/, float /*one_thresh*/,
+                                     int64_t* labels, float* probs) {
+        predict_batch(rows, n, labels, probs);
+        return 0;
+    }
+
+    virtual size_t num_trees() const { return 0; }	// 0 when not known
+
+    virtual size_t num_features() const = 0;
+    virtual size_t num_classes() const = 0;
+};
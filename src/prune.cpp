@@ -4,6 +4,8 @@
 #include <vector>
 #include <unordered_set>
 
+#include "hypergraph.h"
+
 using namespace std;
 
 vector<pair<int, float>> ones, zeros;
@@ -21,19 +23,30 @@ bool compareDesc(const std::pair<int, float>& a, const std::pair<int, float>& b)
     return a.second > b.second;
 }
 
-void prune(const vector<vector<int>> &sets, const vector<unordered_set<int>> &member, unordered_set<int> &final, const int &nElems){
+void prune(const Hypergraph &hg, unordered_set<int> &final){
 	sort(zeros.begin(), zeros.end(), compareDesc);
 
-	int nSets = sets.size(); 
+	int nSets = hg.sets(), nElems = hg.elems(); 
 	setSize.resize(nSets); 
 	delSet.resize(nSets, false);
 	delElem.resize(nElems + 1, false);
 
-	for(int i = 0; i < nSets; i++) setSize[i] = sets[i].size();
+	// sizes within what is left of the instance, elements and edges may have been flagged already.
+	// Counted from the incidence lists, which are ascending: an element listed twice in an edge
+	// shows up there twice in a row and counts once
+	fill(setSize.begin(), setSize.end(), 0); 
+	for(int v = 1; v <= nElems; v++){
+		if(delElem[v]) continue; 
+		int last = -1; 
+		for(int p: hg.incident(v)){
+			if(p != last && !delSet[p]) setSize[p]++; 
+			last = p; 
+		}
+	}
 	for(auto r: ones){
 		delElem[r.first] = 1;
 		final.insert(r.first); 
-		for(int p: member[r.first]){
+		for(int p: hg.incident(r.first)){
 			delSet[p] = 1; 
 		}
 	}
@@ -42,8 +55,10 @@ void prune(const vector<vector<int>> &sets, const vector<unordered_set<int>> &me
 		int breaker = -1; 
 		bool becomesEmpty = false; 
 		vector<int> changed_sets;
-		for (int p : member[r.first]) {
-		    if (delSet[p]) continue;
+		int last = -1;
+		for (int p : hg.incident(r.first)) {
+		    if (delSet[p] || p == last) continue;
+		    last = p;
 		    if (setSize[p] <= 3) {
 		        becomesEmpty = true;
 		        breaker = p;
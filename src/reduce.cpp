@@ -0,0 +1,460 @@
+#include "reduce.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include "parallel.h"
+#include "deadline.h"
+
+using namespace std;
+
+namespace {
+
+enum Rule { SINGLETON, EDGE_DOMINATION, DEGREE_ONE, ELEMENT_DOMINATION, NUM_RULES };
+const char *rule_name[NUM_RULES] = {"singleton edges", "dominated edges", "degree 1 elements", "dominated elements"};
+
+// the instance shrinks in place: nothing is rebuilt, dead elements and edges are only flagged and
+// skipped. An edge whose size drops or an element whose degree drops goes back on its worklist,
+// as only those can newly match a rule
+struct Kernel {
+    const Hypergraph &hg;
+    int nElems, nSets;
+    CSR edges;                              // the edges without repeated elements
+    vector<char> liveElem, liveSet;
+    vector<int> esize, vdeg;                // live elements of an edge, live edges of an element
+    vector<int> qe, qv;
+    vector<char> inqe, inqv;
+    vector<int> mark;                       // stamps for the subset tests
+    vector<uint64_t> esig, vsig;            // sketches of an edge's elements and an element's edges, see bit()
+    int stamp = 0;
+    vector<int> forced;
+    long long applied[NUM_RULES] = {}, dropped = 0, isolated = 0, duplicates = 0;
+    double secs[NUM_RULES] = {};
+
+    Kernel(const Hypergraph &hg) : hg(hg), nElems(hg.elems()), nSets(hg.sets()) {
+        // every edge sorted and without repeats, in parallel, then the rows are moved together
+        const CSRView &ev = hg.edge_csr();
+        edges.ids.assign(ev.ids, ev.ids + hg.incidences());
+        vector<int> len(nSets);
+        parallel_for(0, nSets, [&](long lo, long hi) {
+            for (long s = lo; s < hi; s++) {
+                int *b = edges.ids.data() + ev.off[s], *e = edges.ids.data() + ev.off[s + 1];
+                sort(b, e);
+                len[s] = (int) (unique(b, e) - b);
+            }
+        });
+        edges.off.assign(nSets + 1, 0);
+        for (int s = 0; s < nSets; s++) {
+            edges.off[s + 1] = edges.off[s] + len[s];
+            if (edges.off[s] != ev.off[s]) copy_n(edges.ids.begin() + ev.off[s], len[s], edges.ids.begin() + edges.off[s]);
+        }
+        edges.ids.resize(edges.off[nSets]);
+        edges.ids.shrink_to_fit();
+        liveElem.assign(nElems + 1, 1);
+        liveSet.assign(nSets, 1);
+        esize.resize(nSets);
+        vdeg.assign(nElems + 1, 0);
+        for (int s = 0; s < nSets; s++) {
+            esize[s] = edges.size(s);
+            for (int v : edges.row(s)) vdeg[v]++;
+        }
+        // domination is settled for all edges and elements at once by drop_supersets and
+        // drop_dominated, after that only singletons and what shrinks need a look
+        inqe.assign(nSets, 0);
+        inqv.assign(nElems + 1, 0);
+        for (int s = nSets - 1; s >= 0; s--) {
+            if (esize[s] == 1) push_edge(s);
+        }
+        mark.assign(max(nElems + 1, nSets), 0);
+    }
+
+    // one of 64 bits picked by hashing x. The OR over a set has every bit of each subset set, and
+    // as elements only ever leave an edge the sketch taken when it was bigger stays a valid filter
+    static uint64_t bit(int x) { return 1ull << ((uint32_t) x * 0x9E3779B1u >> 26); }
+
+    // incident() repeats an edge that lists the element twice
+    template <typename F>
+    void live_edges(int v, F f) {
+        int last = -1;
+        for (int s : hg.incident(v)) {
+            if (s != last && liveSet[s]) f(s);
+            last = s;
+        }
+    }
+    template <typename F>
+    void live_elems(int s, F f) {
+        for (int v : edges.row(s)) {
+            if (liveElem[v]) f(v);
+        }
+    }
+
+    void push_edge(int s) { if (!inqe[s]) inqe[s] = 1, qe.push_back(s); }
+    void push_elem(int v) { if (!inqv[v]) inqv[v] = 1, qv.push_back(v); }
+
+    void drop_edge(int s) {
+        liveSet[s] = 0;
+        live_elems(s, [&](int v) { vdeg[v]--; push_elem(v); });
+    }
+    void drop_elem(int v) {
+        liveElem[v] = 0;
+        live_edges(v, [&](int s) { esize[s]--; push_edge(s); });
+    }
+    void take(int v) {
+        forced.push_back(v);
+        liveElem[v] = 0;
+        live_edges(v, [&](int s) { dropped++; drop_edge(s); });
+    }
+
+    // drops every other live edge that contains all of s, looking only at the edges of the
+    // element of s with the fewest
+    void dominate_supersets(int s) {
+        int k = esize[s], u = -1;
+        uint64_t g = 0;
+        stamp++;
+        live_elems(s, [&](int v) {
+            mark[v] = stamp;
+            g |= bit(v);
+            if (u < 0 || vdeg[v] < vdeg[u]) u = v;
+        });
+        esig[s] = g;
+        vector<int> sup;
+        live_edges(u, [&](int f) {
+            if (f == s || esize[f] < k || (g & ~esig[f])) return;
+            int c = 0;
+            live_elems(f, [&](int v) { c += mark[v] == stamp; });
+            if (c == k) sup.push_back(f);
+        });
+        for (int f : sup) {
+            applied[EDGE_DOMINATION]++;
+            drop_edge(f);
+        }
+    }
+
+    // e is in f, both sorted: a merge that gives up as soon as f runs short or passes an element
+    // of e, or a galloping search through f when e is much smaller
+    static bool contains(span<const int> f, span<const int> e) {
+        size_t i = 0, j = 0;
+        if (f.size() > 8 * e.size()) {
+            auto it = f.begin();
+            for (int v : e) {
+                it = lower_bound(it, f.end(), v);
+                if (it == f.end() || *it != v) return false;
+                ++it;
+            }
+            return true;
+        }
+        while (i < e.size()) {
+            if (f.size() - j < e.size() - i || f[j] > e[i]) return false;
+            i += f[j] == e[i];
+            j++;
+        }
+        return true;
+    }
+
+    // edge domination over the whole instance at once. Equal edges are found by sorting on
+    // their hash and the lowest id of each stays; an edge with a strict subset among the
+    // others is dropped, the candidates being the edges of the subset's rarest element. Every
+    // edge left over is then minimal, whichever of its subsets were dropped themselves
+    void drop_supersets() {
+        vector<uint64_t> h(nSets);
+        esig.resize(nSets);
+        vector<int> rare(nSets);
+        vector<atomic<char>> sup(nSets);
+        parallel_for(0, nSets, [&](long lo, long hi) {
+            for (long s = lo; s < hi; s++) {
+                uint64_t x = 0, g = 0;
+                int u = -1;
+                for (int v : edges.row(s)) {
+                    x = (x ^ (uint32_t) v) * 0x9E3779B97F4A7C15ull;
+                    g |= bit(v);
+                    if (u < 0 || vdeg[v] < vdeg[u]) u = v;
+                }
+                h[s] = x ^ x >> 29;
+                esig[s] = g;
+                rare[s] = u;
+            }
+        });
+        vector<pair<uint64_t, int>> ord(nSets);
+        for (int s = 0; s < nSets; s++) ord[s] = {h[s], s};
+        sort(ord.begin(), ord.end());
+        for (int i = 0, j; i < nSets; i = j) {
+            for (j = i + 1; j < nSets && ord[j].first == ord[i].first; j++) {}
+            for (int a = i; a < j; a++) {
+                int x = ord[a].second;
+                if (sup[x]) continue;
+                for (int b = a + 1; b < j; b++) {
+                    int y = ord[b].second;
+                    if (!sup[y] && ranges::equal(edges.row(x), edges.row(y))) sup[y] = 1, duplicates++;
+                }
+            }
+        }
+
+        // edges with the same rarest element are taken together, so its candidates stay in cache
+        // empty edges are left out: they cannot be hit and dominate nothing
+        vector<int> by(nSets), at(nElems + 2, 0);
+        for (int s = 0; s < nSets; s++) {
+            if (rare[s] >= 0) at[rare[s] + 1]++;
+        }
+        for (int v = 0; v <= nElems; v++) at[v + 1] += at[v];
+        for (int s = 0; s < nSets; s++) {
+            if (rare[s] >= 0) by[at[rare[s]]++] = s;
+        }
+        int n = at[nElems];
+        parallel_for(0, n, [&](long lo, long hi) {
+            for (long i = lo; i < hi; i++) {
+                int s = by[i], last = -1;
+                auto e = edges.row(s);
+                for (int f : hg.incident(rare[s])) {
+                    if (f == last) continue;
+                    last = f;
+                    if (esize[f] > esize[s] && !(esig[s] & ~esig[f]) && !sup[f].load(memory_order_relaxed)
+                        && contains(edges.row(f), e)) {
+                        sup[f].store(1, memory_order_relaxed);
+                    }
+                }
+            }
+        });
+        for (int s = 0; s < nSets; s++) {
+            if (!sup[s]) continue;
+            applied[EDGE_DOMINATION]++;
+            drop_edge(s);
+        }
+    }
+
+    // every live edge of u is an edge of w. Incidence lists are ascending, an edge that lists the
+    // element twice appears twice
+    bool covers(int w, int u) const {
+        auto a = hg.incident(u), b = hg.incident(w);
+        size_t j = 0;
+        for (size_t i = 0; i < a.size(); i++) {
+            int s = a[i];
+            if (!liveSet[s] || (i && a[i - 1] == s)) continue;
+            while (j < b.size() && b[j] < s) j++;
+            if (j == b.size() || b[j] != s) return false;
+        }
+        return true;
+    }
+
+    // element domination over the whole instance at once, in parallel over the elements. The
+    // candidates for u are the other elements of its smallest live edge; a sketch of the edges of
+    // every element rejects most of them before the incidence lists are merged. Of two elements
+    // with the same edges the lower id stays, so every element dropped is covered by one that is left
+    void drop_dominated() {
+        for (int v : qv) inqv[v] = 0;       // what drop_supersets changed is looked at here
+        qv.clear();
+        vsig.assign(nElems + 1, 0);
+        vector<int> small(nElems + 1, -1);
+        parallel_for(1, nElems + 1, [&](long lo, long hi) {
+            for (long v = lo; v < hi; v++) {
+                if (!liveElem[v]) continue;
+                uint64_t g = 0;
+                int e = -1;
+                live_edges(v, [&](int s) {
+                    g |= bit(s);
+                    if (e < 0 || esize[s] < esize[e]) e = s;
+                });
+                vsig[v] = g;
+                small[v] = e;
+            }
+        });
+        vector<char> dom(nElems + 1, 0);
+        parallel_for(1, nElems + 1, [&](long lo, long hi) {
+            for (long u = lo; u < hi; u++) {
+                if (small[u] < 0) continue;     // dead, or in no live edge
+                for (int w : edges.row(small[u])) {
+                    if (w == u || !liveElem[w] || vdeg[w] < vdeg[u] || (vdeg[w] == vdeg[u] && w > u)) continue;
+                    if (!(vsig[u] & ~vsig[w]) && covers(w, u)) {
+                        dom[u] = 1;
+                        break;
+                    }
+                }
+            }
+        });
+        for (int v = 1; v <= nElems; v++) {
+            if (!dom[v]) continue;
+            applied[vdeg[v] == 1 ? DEGREE_ONE : ELEMENT_DOMINATION]++;
+            drop_elem(v);
+        }
+        for (int v = nElems; v >= 1; v--) {
+            if (liveElem[v] && vdeg[v] == 0) push_elem(v);
+        }
+    }
+
+    // some other live element in every live edge of u, looking only at the elements of the
+    // smallest of those edges
+    bool dominated(int u) {
+        int d = vdeg[u], e = -1;
+        uint64_t g = 0;
+        stamp++;
+        live_edges(u, [&](int s) {
+            mark[s] = stamp;
+            g |= bit(s);
+            if (e < 0 || esize[s] < esize[e]) e = s;
+        });
+        vsig[u] = g;
+        for (int w : edges.row(e)) {
+            if (w == u || !liveElem[w] || vdeg[w] < d || (g & ~vsig[w])) continue;
+            int c = 0;
+            live_edges(w, [&](int s) { c += mark[s] == stamp; });
+            if (c == d) return true;
+        }
+        return false;
+    }
+
+    // each rule leaves an equivalent instance, so past the deadline the kernel is simply left as is
+    void run() {
+        if (!deadline_passed()) timed(EDGE_DOMINATION, [&] { drop_supersets(); });
+        if (!deadline_passed()) timed(ELEMENT_DOMINATION, [&] { drop_dominated(); });
+        while ((!qe.empty() || !qv.empty()) && !deadline_passed()) {
+            // edges first: a singleton decides an element outright
+            if (!qe.empty()) {
+                int s = qe.back();
+                qe.pop_back();
+                inqe[s] = 0;
+                if (!liveSet[s] || esize[s] == 0) continue;	// an empty edge cannot be hit
+                if (esize[s] == 1) {
+                    timed(SINGLETON, [&] {
+                        int v = -1;
+                        live_elems(s, [&](int w) { v = w; });
+                        applied[SINGLETON]++;
+                        take(v);
+                    });
+                } else {
+                    timed(EDGE_DOMINATION, [&] { dominate_supersets(s); });
+                }
+                continue;
+            }
+            int v = qv.back();
+            qv.pop_back();
+            inqv[v] = 0;
+            if (!liveElem[v]) continue;
+            if (vdeg[v] == 0) {
+                isolated++;
+                liveElem[v] = 0;
+            } else if (vdeg[v] == 1) {
+                // its edge is not a singleton, or it would have been taken already
+                timed(DEGREE_ONE, [&] {
+                    int s = -1;
+                    live_edges(v, [&](int f) { s = f; });
+                    if (esize[s] > 1) {
+                        applied[DEGREE_ONE]++;
+                        drop_elem(v);
+                    }
+                });
+            } else {
+                timed(ELEMENT_DOMINATION, [&] {
+                    if (dominated(v)) {
+                        applied[ELEMENT_DOMINATION]++;
+                        drop_elem(v);
+                    }
+                });
+            }
+        }
+    }
+
+    template <typename F>
+    void timed(Rule r, F f) {
+        auto t0 = chrono::steady_clock::now();
+        f();
+        secs[r] += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    }
+};
+
+}
+
+Reduction reduce(const Hypergraph &hg) {
+    auto start = chrono::steady_clock::now();
+    Kernel k(hg);
+    k.run();
+
+    Reduction r;
+    r.forced = move(k.forced);
+    r.delElem.assign(hg.elems() + 1, true);
+    r.delSet.assign(hg.sets(), true);
+    for (int v = 1; v <= hg.elems(); v++) {
+        if (k.liveElem[v]) r.delElem[v] = false, r.undecided.push_back(v);
+    }
+    int sets = 0;
+    for (int s = 0; s < hg.sets(); s++) {
+        if (k.liveSet[s]) r.delSet[s] = false, sets++;
+    }
+
+    cerr << "reduction: " << r.forced.size() << " forced, kernel of " << r.undecided.size() << " of " << hg.elems()
+         << " elements and " << sets << " of " << hg.sets() << " hyperedges ("
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s)\n";
+    for (int i = 0; i < NUM_RULES; i++) cerr << "  " << rule_name[i] << ": " << k.applied[i] << " (" << k.secs[i] << " s)\n";
+    cerr << "  hit by forced elements: " << k.dropped << " hyperedges, isolated: " << k.isolated << " elements, duplicate hyperedges: " << k.duplicates << "\n";
+    return r;
+}
+
+void merge_twins(const Hypergraph &hg, const vector<bool> &delSet, vector<bool> &delElem) {
+    auto start = chrono::steady_clock::now();
+    int nElems = hg.elems();
+    // the live edges of v once each, incident() repeats an edge that lists v twice
+    auto next = [&](span<const int> r, size_t &k) {
+        while (k < r.size() && (delSet[r[k]] || (k && r[k - 1] == r[k]))) k++;
+    };
+    vector<uint64_t> h(nElems + 1);
+    vector<int> deg(nElems + 1, 0);
+    parallel_for(1, nElems + 1, [&](long lo, long hi) {
+        for (long v = lo; v < hi; v++) {
+            if (delElem[v]) continue;
+            auto r = hg.incident(v);
+            uint64_t x = 0;
+            for (size_t k = 0; next(r, k), k < r.size(); k++) {
+                x = (x ^ (uint32_t) r[k]) * 0x9E3779B97F4A7C15ull;
+                deg[v]++;
+            }
+            h[v] = x ^ x >> 29;
+        }
+    });
+    auto same = [&](int a, int b) {
+        auto x = hg.incident(a), y = hg.incident(b);
+        size_t i = 0, j = 0;
+        for (;; i++, j++) {
+            next(x, i);
+            next(y, j);
+            if (i == x.size() || j == y.size()) return i == x.size() && j == y.size();
+            if (x[i] != y[j]) return false;
+        }
+    };
+
+    // equal lists have equal hashes, the lowest id of each run of equal lists is the representative
+    vector<pair<uint64_t, int>> ord;
+    long long elems = 0, before = 0, isolated = 0, classes = 0, merged = 0;
+    for (int v = 1; v <= nElems; v++) {
+        if (delElem[v]) continue;
+        elems++;
+        before += deg[v];
+        if (deg[v]) ord.push_back({h[v], v});
+        else delElem[v] = true, isolated++;
+    }
+    sort(ord.begin(), ord.end());
+    vector<char> twin(nElems + 1, 0);
+    long long after = before;
+    for (size_t i = 0, j; i < ord.size(); i = j) {
+        for (j = i + 1; j < ord.size() && ord[j].first == ord[i].first; j++) {}
+        for (size_t a = i; a < j; a++) {
+            int x = ord[a].second, n = 0;
+            if (twin[x]) continue;
+            for (size_t b = a + 1; b < j; b++) {
+                int y = ord[b].second;
+                if (!twin[y] && deg[y] == deg[x] && same(x, y)) twin[y] = 1, n++;
+            }
+            if (!n) continue;
+            classes++;
+            merged += n;
+            after -= (long long) n * deg[x];
+        }
+    }
+    for (int v = 1; v <= nElems; v++) {
+        if (twin[v]) delElem[v] = true;
+    }
+
+    cerr << "twins: " << merged << " elements merged into " << classes << " classes, " << isolated
+         << " without a live edge dropped; " << elems - merged - isolated << " of " << elems << " elements and "
+         << after << " of " << before << " incidences left for the search ("
+         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s)\n";
+}
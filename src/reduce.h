@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include "hypergraph.h"
+
+// exact hitting set reductions, applied to a fixpoint before the features. Whatever they decide
+// needs neither features, nor a prediction, nor local search:
+//   singleton edge      its element is in every solution, the edges it hits are dropped
+//   edge domination     an edge containing another edge is hit with it and is dropped
+//   degree 1 element    dominated by any other element of its edge, dropped
+//   element domination  an element whose edges all contain some other element v is dropped
+//                       (v is at least as good); of two elements with the same edges one stays
+// the elements and edges that are left are the kernel
+struct Reduction {
+    std::vector<int> forced;            // in every solution found from the kernel
+    std::vector<int> undecided;         // elements of the kernel, ascending
+    std::vector<bool> delElem, delSet;  // elements (1-based) and edges outside the kernel
+};
+
+Reduction reduce(const Hypergraph &hg);
+
+// elements with the same live edges are interchangeable for the local search: of each class only
+// the lowest stays, the others are flagged in delElem, as is every element without a live edge.
+// What is kept stands for its whole class, so a solution of the rest needs no translation back
+void merge_twins(const Hypergraph &hg, const std::vector<bool> &delSet, std::vector<bool> &delElem);
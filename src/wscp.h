@@ -1,5 +1,10 @@
 /*
-        only void WSCP::build_instance(char *file_name) has been modified. 
+        modified: void WSCP::build_instance(char *file_name) reads a Hypergraph, and the clock and
+        the random numbers belong to each WSCP (wall time, rand_r) so that several can run at once,
+        and several searches can share one reduced instance (share_instance) and one best cost,
+        and restart from solutions of each other (exchange, load_solu), which also lets init start
+        from a given solution. local_search also stops on the step the global deadline passes
+        (deadline.h), and the checks report to cerr.
         Original algorithm can be found at:     https://github.com/chuanluocs/NuSC-Algorithm/tree/master
 */
 #include <iostream>
@@ -9,30 +14,23 @@
 #include <limits.h>
 #include <float.h>
 #include <memory.h>
-#include <sys/times.h>
 #include <unistd.h>
+#include <chrono>
+#include <atomic>
+#include <functional>
 #include <math.h>
 #include <set>
 #include <algorithm>
 #include <utility>
 
+#include "hypergraph.h"
+#include "deadline.h"
+
 using namespace std;
 
 #define mypop(stack) stack[--stack##_fill_pointer]
 #define mypush(item, stack) stack[stack##_fill_pointer++] = item
 
-static struct tms start_time;
-static double get_runtime()
-{
-    struct tms stop;
-    times(&stop);
-    return (double)(stop.tms_utime - start_time.tms_utime + stop.tms_stime - start_time.tms_stime) / sysconf(_SC_CLK_TCK);
-}
-static void start_timing()
-{
-    times(&start_time);
-}
-
 class WSCP
 {
   public:
@@ -70,8 +68,9 @@ class WSCP
     int set_count;
 
     //date structure
-    int cutoff_time;
-    int seed;
+    double cutoff_time;
+    chrono::steady_clock::time_point start_time;
+    unsigned seed;
     int t;
     long long step;
     long long max_step;
@@ -89,18 +88,34 @@ class WSCP
     int **set_var;
     int *set_var_num;
     int *org_set_var_num;
+    int *var_set_pool;  //rows of var_set/set_var live in these two blocks
+    int *set_var_pool;
 
     int *goodset_stack;
     int goodset_stack_fill_pointer;
 
+    bool shared_instance = false;               //the arrays of the instance belong to another WSCP
+    atomic<long long> *global_best = nullptr;   //lowest best_cost of all searches, if set
+    function<void(WSCP &)> exchange;            //called with every time check of local_search, if set
+
     WSCP();
-    WSCP(int time_limit);
+    WSCP(double time_limit, unsigned seed);
+    void start_timing() { start_time = chrono::steady_clock::now(); }
+    double get_runtime() const { return chrono::duration<double>(chrono::steady_clock::now() - start_time).count(); }
+    // hide the shared C library generators from the search code below
+    int rand() { return rand_r(&seed); }
+    int random() { return rand_r(&seed); }
     void all_memory();
+    void search_memory();
     void free_memory();
+    void share_instance(const WSCP &from);
+    void load_solu(const int *solu);
+    void update_best();
+    bool time_up();
 
-    void build_instance(vector<vector<int>> &notun, int &updElem, int &updSet);
+    void build_instance(const Hypergraph &notun);
     void reduce_instance();
-    void init();
+    void init(const int *start = nullptr);
     void local_search();
     void add_set(int s);
     void remove_set(int s);
@@ -128,6 +143,7 @@ class WSCP
 
 WSCP::WSCP()
 {
+    seed = 1;
     step = 0;
     t = 170;
     cutoff_time = 1000;
@@ -135,7 +151,7 @@ WSCP::WSCP()
     max_tries = INT_MAX;
 }
 
-WSCP::WSCP(int time_limit)
+WSCP::WSCP(double time_limit, unsigned seed) : seed(seed)
 {
     step = 0;
     t = 170;
@@ -271,13 +287,31 @@ void WSCP::all_memory()
     int max_set_num = set_num + 10;
     int max_var_num = var_num + 10;
 
+    search_memory();
+    cost = new int[max_set_num];
+    org_cost = new int[max_set_num];
+    fix = new int[max_set_num];
+
+    //date structure
+    var_delete = new int[max_var_num];
+    var_set = new int *[max_var_num];
+    var_set_num = new int[max_var_num];
+    org_var_set_num = new int[max_var_num];
+    set_var = new int *[max_set_num];
+    set_var_num = new int[max_set_num];
+    org_set_var_num = new int[max_set_num];
+}
+
+//what a search changes; the rest is the instance, only read once reduce_instance is done
+void WSCP::search_memory()
+{
+    int max_set_num = set_num + 10;
+    int max_var_num = var_num + 10;
+
     score = new long long[max_set_num];
     pscore = new long long[max_set_num];
     time_stamp = new long long[max_set_num];
-    cost = new int[max_set_num];
-    org_cost = new int[max_set_num];
     cc = new bool[max_set_num];
-    fix = new int[max_set_num];
     zero_stack = new int[max_set_num];
     index_in_zero_stack = new int[max_set_num];
 
@@ -295,27 +329,41 @@ void WSCP::all_memory()
     set_solu = new int[max_set_num];
     index_in_set_solu = new int[max_set_num];
 
-    //date structure
-    var_delete = new int[max_var_num];
-    var_set = new int *[max_var_num];
-    var_set_num = new int[max_var_num];
-    org_var_set_num = new int[max_var_num];
-    set_var = new int *[max_set_num];
-    set_var_num = new int[max_set_num];
-    org_set_var_num = new int[max_set_num];
-
     goodset_stack = new int[max_set_num];
 }
 
+//searches the instance built and reduced by from, which has to outlive this WSCP
+void WSCP::share_instance(const WSCP &from)
+{
+    var_num = from.var_num;
+    set_num = from.set_num;
+    t = from.t;
+    compareVersion = from.compareVersion;
+    reduce_cost = from.reduce_cost;
+
+    cost = from.cost;
+    org_cost = from.org_cost;
+    fix = from.fix;
+    var_delete = from.var_delete;
+    var_set = from.var_set;
+    var_set_num = from.var_set_num;
+    org_var_set_num = from.org_var_set_num;
+    set_var = from.set_var;
+    set_var_num = from.set_var_num;
+    org_set_var_num = from.org_set_var_num;
+    var_set_pool = from.var_set_pool;
+    set_var_pool = from.set_var_pool;
+    shared_instance = true;
+
+    search_memory();
+}
+
 void WSCP::free_memory()
 {
     delete score;
     delete pscore;
     delete time_stamp;
-    delete cost;
-    delete org_cost;
     delete cc;
-    delete fix;
     delete zero_stack;
     delete index_in_zero_stack;
 
@@ -331,8 +379,16 @@ void WSCP::free_memory()
     delete set_solu;
     delete index_in_set_solu;
 
-    for (int i = 0; i < var_num; ++i)
-        delete var_set[i];
+    delete goodset_stack;
+    if (shared_instance)
+        return;
+
+    delete cost;
+    delete org_cost;
+    delete fix;
+
+    delete[] var_set_pool;
+    delete[] set_var_pool;
 
     delete var_delete;
     delete var_set;
@@ -340,18 +396,14 @@ void WSCP::free_memory()
     delete org_var_set_num;
     delete org_set_var_num;
 
-    for (int i = 0; i < set_num; ++i)
-        delete set_var[i];
     delete set_var;
     delete set_var_num;
-
-    delete goodset_stack;
 }
 
-void WSCP::build_instance(vector<vector<int>> &notun, int &updElem, int &updSet)
+void WSCP::build_instance(const Hypergraph &notun)
 {
-    var_num = updElem;
-    set_num = updSet;
+    var_num = notun.sets();
+    set_num = notun.elems();
 
     if(set_num > var_num)
     {
@@ -378,33 +430,25 @@ void WSCP::build_instance(vector<vector<int>> &notun, int &updElem, int &updSet)
         cost[i] = 1;
         org_cost[i] = cost[i];
     }
-    memset(set_var_num, 0, set_num * sizeof(int));
     memset(fix, 0, set_num * sizeof(bool));
+    //var i is hyperedge i, set s is element s + 1 of the hypergraph
+    var_set_pool = new int[notun.incidences() + 1];
+    set_var_pool = new int[notun.incidences() + 1];
+    int *p = var_set_pool;
     for (int i = 0; i < var_num; ++i)
     {
-        var_set_num[i] = notun[i].size();
-        var_set[i] = new int[var_set_num[i] + 1];
-        for (int j = 0; j < var_set_num[i]; ++j)
-        {
-            var_set[i][j] = notun[i][j];
-            --var_set[i][j];
-            ++set_var_num[var_set[i][j]];
-        }
+        var_set[i] = p;
+        var_set_num[i] = notun.edge_size(i);
+        for (int v : notun.edge(i))
+            *p++ = v - 1;
     }
-
+    p = set_var_pool;
     for (int i = 0; i < set_num; ++i)
     {
-        set_var[i] = new int[set_var_num[i] + 1];
-        set_var_num[i] = 0; //reset for buile set_var
-    }
-    //build set_var
-    for (int i = 0; i < var_num; ++i)
-    {
-        for (int j = 0; j < var_set_num[i]; ++j)
-        {
-            int cur_set = var_set[i][j];
-            set_var[cur_set][set_var_num[cur_set]++] = i;
-        }
+        set_var[i] = p;
+        set_var_num[i] = notun.degree(i + 1);
+        for (int s : notun.incident(i + 1))
+            *p++ = s;
     }
 }
 
@@ -972,10 +1016,13 @@ void WSCP::flip(int flip_set)
     score[flip_set] = -flip_set_score;
 }
 
-void WSCP::init()
+//start, if given, is loaded as the first solution and only what it leaves uncovered is chosen
+//the NuSC way, from a random uncovered var at a time
+void WSCP::init(const int *start)
 {
     cur_cost = reduce_cost;
     best_cost = INT_MAX;
+    best_time = 0;
     for (int i = 0; i < set_num; ++i)
     {
         best_solu[i] = -1;
@@ -1019,6 +1066,8 @@ void WSCP::init()
 
     //init feasible solution
     zero_stack_fill_pointer = 0;
+    if (start)
+        load_solu(start);
     //cout << "Start initialize feasible solution! " << endl;
     while (uncover_stack_fill_pointer > 0)
     {
@@ -1052,6 +1101,115 @@ void WSCP::init()
     }
 }
 
+void WSCP::update_best()
+{
+    best_cost = cur_cost;
+    best_time = get_runtime();
+    //cout << "o " << best_cost << " " << best_time << endl;
+    for (int i = 0; i < set_num; ++i)
+        best_solu[i] = cur_solu[i];
+    if (global_best)
+    {
+        long long g = global_best->load(memory_order_relaxed);
+        while (best_cost < g && !global_best->compare_exchange_weak(g, best_cost, memory_order_relaxed))
+            ;
+    }
+}
+
+//makes solu the current solution, fixed sets keep their value. Everything flip keeps up to date
+//is computed again under the current weights; by cover count c of a var of weight w, a set in the
+//solution has score -w for each var with c = 1 and pscore -w for each with c = 2, any other set
+//score w for each var with c = 0 and pscore w for each with c = 1
+void WSCP::load_solu(const int *solu)
+{
+    cur_cost = reduce_cost;
+    set_count = 0;
+    zero_stack_fill_pointer = 0;
+    uncover_stack_fill_pointer = 0;
+    for (int i = 0; i < set_num; ++i)
+    {
+        if (fix[i] == 1)
+            cur_cost += cost[i];
+        if (fix[i] != 0)
+            continue;
+        cur_solu[i] = solu[i] == 1;
+        cc[i] = 1;
+        index_in_set_solu[i] = -1;
+        index_in_zero_stack[i] = -1;
+        if (cur_solu[i] == 1)
+        {
+            add_set(i);
+            cur_cost += cost[i];
+        }
+    }
+    for (int i = 0; i < var_num; ++i)
+    {
+        if (var_delete[i] == 1)
+            continue;
+        cover_count[i] = 0;
+        index_in_uncover_stack[i] = -1;
+        for (int j = 0; j < var_set_num[i]; ++j)
+        {
+            score[var_set[i][j]] = 0;
+            pscore[var_set[i][j]] = 0;
+        }
+    }
+    for (int k = 0; k < set_count; ++k)
+    {
+        int s = set_solu[k];
+        score[s] = pscore[s] = 0;
+        for (int i = 0; i < set_var_num[s]; ++i)
+        {
+            int v = set_var[s][i];
+            if (cover_count[v] == 0)
+                cover_set[v] = s;
+            else if (cover_count[v] == 1)
+                cover_set2[v] = s;
+            ++cover_count[v];
+        }
+    }
+    for (int i = 0; i < var_num; ++i)
+    {
+        if (var_delete[i] == 1 || cover_count[i] > 2)
+            continue;
+        if (cover_count[i] == 0)
+            uncover(i);
+        long long w = weight[i];
+        for (int j = 0; j < var_set_num[i]; ++j)
+        {
+            int s = var_set[i][j];
+            bool in = cur_solu[s] == 1 && fix[s] == 0;
+            if (cover_count[i] == 0)
+                score[s] += w;
+            else if (cover_count[i] == 1 && in)
+                score[s] -= w;
+            else if (cover_count[i] == 1)
+                pscore[s] += w;
+            else if (in)
+                pscore[s] -= w;
+        }
+    }
+    for (int k = 0; k < set_count; ++k)
+    {
+        int s = set_solu[k];
+        if (score[s] == 0)
+        {
+            index_in_zero_stack[s] = zero_stack_fill_pointer;
+            mypush(s, zero_stack);
+        }
+    }
+}
+
+//the time check of local_search, which is also where the search meets the others
+bool WSCP::time_up()
+{
+    if (get_runtime() > cutoff_time)
+        return true;
+    if (exchange)
+        exchange(*this);
+    return false;
+}
+
 int WSCP::select_set(int is_tabu)
 {
     int sr = INT_MIN, ct = 1, i;
@@ -1234,6 +1392,13 @@ void WSCP::local_search()
     {
         for (step = 0; step < max_step; ++step)
         {
+            if (deadline_passed())
+            {
+                //the solution of init is kept even when the deadline came first
+                if (uncover_stack_fill_pointer == 0 && cur_cost < best_cost)
+                    update_best();
+                return;
+            }
             if (uncover_stack_fill_pointer == 0)
             {
                 if (zero_stack_fill_pointer > 0)
@@ -1246,13 +1411,7 @@ void WSCP::local_search()
                     continue;
                 }
                 else if (cur_cost < best_cost)
-                {
-                    best_cost = cur_cost;
-                    best_time = get_runtime();
-                    //cout << "o " << best_cost << " " << best_time << endl;
-                    for (int i = 0; i < set_num; ++i)
-                        best_solu[i] = cur_solu[i];
-                }
+                    update_best();
             }
             if (uncover_stack_fill_pointer > 0)
             {
@@ -1281,7 +1440,7 @@ void WSCP::local_search()
                         time_stamp[best_set] = step;
                         if (step % 1000 == 0)
                         {
-                            if (get_runtime() > cutoff_time)
+                            if (time_up())
                                 return;
                         }
                         continue;
@@ -1307,7 +1466,7 @@ void WSCP::local_search()
 
                         if (step % 1000 == 0)
                         {
-                            if (get_runtime() > cutoff_time)
+                            if (time_up())
                                 return;
                         }
                         continue;
@@ -1322,7 +1481,7 @@ void WSCP::local_search()
                     time_stamp[best_set] = step;
                     if (step % 1000 == 0)
                     {
-                        if (get_runtime() > cutoff_time)
+                        if (time_up())
                             return;
                     }
                     continue;
@@ -1337,7 +1496,7 @@ void WSCP::local_search()
             time_stamp[flip_set] = step;
             if (step % 1000 == 0)
             {
-                if (get_runtime() > cutoff_time)
+                if (time_up())
                     return;
             }
         }
@@ -1350,14 +1509,14 @@ void WSCP::check_solu()
     for (int i = 0; i < set_num; ++i)
     {
         if (fix[i] == 1 && best_solu[i] != 1)
-            cout << "wrong 1" << endl;
+            cerr << "wrong 1" << endl;
         if (fix[i] < 0 && best_solu[i] != 0)
-            cout << "wrong 2" << endl;
+            cerr << "wrong 2" << endl;
         if (fix[i] > 9)
         {
             int s = fix[i] - 10;
             if (best_solu[i] != 0)
-                cout << "wrong 3" << endl;
+                cerr << "wrong 3" << endl;
             if (best_solu[s] == 0)
                 best_solu[i] = 1;
         }
@@ -1375,7 +1534,7 @@ void WSCP::check_solu()
         }
         if (flag == 0)
         {
-            cout << "best solu is wrong in 0 " << endl;
+            cerr << "best solu is wrong in 0 " << endl;
             return;
         }
     }
@@ -1399,7 +1558,7 @@ void WSCP::check_solu()
         }
         if (flag == 0)
         {
-            cout << "best solu is wrong in 1" << endl;
+            cerr << "best solu is wrong in 1" << endl;
             return;
         }
     }
@@ -1433,7 +1592,7 @@ void WSCP::check_solu()
     }
 
     if (tem_cost != best_cost)
-        cout << "best solu is wrong in 5 " << endl;
+        cerr << "best solu is wrong in 5 " << endl;
 
     tem_cost = 0;
     for (int i = 0; i < set_num; ++i)
@@ -1468,13 +1627,13 @@ void WSCP::check_cur_solu()
     for (int i = 0; i < set_num; ++i)
     {
         if (fix[i] == 1 && cur_solu[i] != 1)
-            cout << "wrong 11" << endl;
+            cerr << "wrong 11" << endl;
         if (fix[i] < 0 && cur_solu[i] != 0)
-            cout << "wrong 22" << endl;
+            cerr << "wrong 22" << endl;
         if (fix[i] > 9)
         {
             if (cur_solu[i] != 0)
-                cout << "wrong 33" << endl;
+                cerr << "wrong 33" << endl;
         }
     }
 
@@ -1486,5 +1645,5 @@ void WSCP::check_cur_solu()
             tem_cost += org_cost[i];
     }
     if (tem_cost != cur_cost)
-        cout << "some thing wrong in cur cost and tem_cost " << endl;
+        cerr << "some thing wrong in cur cost and tem_cost " << endl;
 }